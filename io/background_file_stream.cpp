@@ -0,0 +1,816 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#include "background_file_stream.h"
+#ifndef _WIN32
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#ifdef __linux
+#include <sys/syscall.h>
+#endif
+#ifdef __NR_io_uring_setup
+#include <sys/mman.h>
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#endif
+#include "../util/constexpr_assert.h"
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace io
+{
+namespace
+{
+constexpr std::size_t maxBufferCount = 1024;
+constexpr std::size_t maxBufferSize = 0x40000000;
+
+#ifdef __NR_io_uring_setup
+/** an io_uring owned by one stream. Each buffer has at most one request in flight, and its
+ * completion carries the buffer's index. Not thread safe.
+ */
+class IOURing final
+{
+    IOURing(const IOURing &) = delete;
+    IOURing &operator=(const IOURing &) = delete;
+
+private:
+    int ringFD = -1;
+    void *submissionRing = MAP_FAILED;
+    std::size_t submissionRingSize = 0;
+    void *completionRing = MAP_FAILED;
+    std::size_t completionRingSize = 0;
+    void *submissionEntries = MAP_FAILED;
+    std::size_t submissionEntriesSize = 0;
+    unsigned *submissionTail = nullptr;
+    unsigned submissionMask = 0;
+    unsigned *submissionArray = nullptr;
+    unsigned *completionHead = nullptr;
+    unsigned *completionTail = nullptr;
+    unsigned completionMask = 0;
+    ::io_uring_cqe *completions = nullptr;
+    unsigned queuedCount = 0;
+    bool buffersRegistered = false;
+    bool canTimeOut = false;
+
+private:
+    IOURing() = default;
+    static void *mapRing(int fd, std::size_t size, std::uint64_t offset) noexcept
+    {
+        return ::mmap(
+            nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+    }
+    template <typename T>
+    static T *getField(void *ring, std::uint32_t offset) noexcept
+    {
+        return reinterpret_cast<T *>(static_cast<unsigned char *>(ring) + offset);
+    }
+    int enter(unsigned submitCount,
+              unsigned waitCount,
+              unsigned flags,
+              const void *argument,
+              std::size_t argumentSize) noexcept
+    {
+        return static_cast<int>(::syscall(__NR_io_uring_enter,
+                                          ringFD,
+                                          submitCount,
+                                          waitCount,
+                                          flags,
+                                          argument,
+                                          argumentSize));
+    }
+
+public:
+    /** @param buffers registered with the kernel if it allows that
+     * @return null if io_uring isn't available */
+    static std::unique_ptr<IOURing> create(const std::vector<::iovec> &buffers)
+    {
+        ::io_uring_params parameters;
+        std::memset(&parameters, 0, sizeof(parameters));
+        int fd = static_cast<int>(::syscall(
+            __NR_io_uring_setup, static_cast<unsigned>(buffers.size()), &parameters));
+        if(fd < 0)
+            return nullptr;
+        std::unique_ptr<IOURing> retval(new IOURing);
+        retval->ringFD = fd;
+        retval->submissionRingSize =
+            parameters.sq_off.array + parameters.sq_entries * sizeof(unsigned);
+        retval->completionRingSize =
+            parameters.cq_off.cqes + parameters.cq_entries * sizeof(::io_uring_cqe);
+        bool singleMapping = parameters.features & IORING_FEAT_SINGLE_MMAP;
+        if(singleMapping && retval->completionRingSize > retval->submissionRingSize)
+            retval->submissionRingSize = retval->completionRingSize;
+        retval->submissionRing = mapRing(fd, retval->submissionRingSize, IORING_OFF_SQ_RING);
+        if(retval->submissionRing == MAP_FAILED)
+            return nullptr;
+        if(singleMapping)
+            retval->completionRing = retval->submissionRing;
+        else
+            retval->completionRing = mapRing(fd, retval->completionRingSize, IORING_OFF_CQ_RING);
+        if(retval->completionRing == MAP_FAILED)
+            return nullptr;
+        retval->submissionEntriesSize = parameters.sq_entries * sizeof(::io_uring_sqe);
+        retval->submissionEntries = mapRing(fd, retval->submissionEntriesSize, IORING_OFF_SQES);
+        if(retval->submissionEntries == MAP_FAILED)
+            return nullptr;
+        retval->submissionTail = getField<unsigned>(retval->submissionRing, parameters.sq_off.tail);
+        retval->submissionMask =
+            *getField<unsigned>(retval->submissionRing, parameters.sq_off.ring_mask);
+        retval->submissionArray =
+            getField<unsigned>(retval->submissionRing, parameters.sq_off.array);
+        retval->completionHead = getField<unsigned>(retval->completionRing, parameters.cq_off.head);
+        retval->completionTail = getField<unsigned>(retval->completionRing, parameters.cq_off.tail);
+        retval->completionMask =
+            *getField<unsigned>(retval->completionRing, parameters.cq_off.ring_mask);
+        retval->completions =
+            getField<::io_uring_cqe>(retval->completionRing, parameters.cq_off.cqes);
+        // registering can fail, for instance over RLIMIT_MEMLOCK; the requests then use iovecs
+        retval->buffersRegistered = ::syscall(__NR_io_uring_register,
+                                              fd,
+                                              IORING_REGISTER_BUFFERS,
+                                              buffers.data(),
+                                              static_cast<unsigned>(buffers.size()))
+                                    == 0;
+#ifdef IORING_FEAT_EXT_ARG
+        retval->canTimeOut = parameters.features & IORING_FEAT_EXT_ARG;
+#endif
+        return retval;
+    }
+    ~IOURing()
+    {
+        if(submissionEntries != MAP_FAILED)
+            ::munmap(submissionEntries, submissionEntriesSize);
+        if(completionRing != MAP_FAILED && completionRing != submissionRing)
+            ::munmap(completionRing, completionRingSize);
+        if(submissionRing != MAP_FAILED)
+            ::munmap(submissionRing, submissionRingSize);
+        ::close(ringFD);
+    }
+    /** adds a read or write to the submission queue; it starts at the next submit
+     * @param request part of buffer bufferIndex; must stay valid until the request completes
+     */
+    void queue(bool isWrite,
+               int fd,
+               std::size_t bufferIndex,
+               const ::iovec &request,
+               std::uint64_t offset) noexcept
+    {
+        unsigned tail = *submissionTail; // only this thread moves the tail
+        unsigned index = tail & submissionMask;
+        ::io_uring_sqe &entry = static_cast<::io_uring_sqe *>(submissionEntries)[index];
+        std::memset(&entry, 0, sizeof(entry));
+        entry.fd = fd;
+        entry.off = offset;
+        entry.user_data = bufferIndex;
+        if(buffersRegistered)
+        {
+            entry.opcode = isWrite ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+            entry.addr = reinterpret_cast<std::uintptr_t>(request.iov_base);
+            entry.len = static_cast<std::uint32_t>(request.iov_len);
+            entry.buf_index = static_cast<std::uint16_t>(bufferIndex);
+        }
+        else
+        {
+            entry.opcode = isWrite ? IORING_OP_WRITEV : IORING_OP_READV;
+            entry.addr = reinterpret_cast<std::uintptr_t>(&request);
+            entry.len = 1;
+        }
+        submissionArray[index] = index;
+        __atomic_store_n(submissionTail, tail + 1, __ATOMIC_RELEASE);
+        queuedCount++;
+    }
+    void submit()
+    {
+        while(queuedCount > 0)
+        {
+            int result = enter(queuedCount, 0, 0, nullptr, 0);
+            if(result < 0)
+            {
+                if(errno == EINTR || errno == EAGAIN)
+                    continue;
+                int error = errno;
+                throw IOError(error, std::generic_category(), "io_uring_enter failed");
+            }
+            queuedCount -= result;
+        }
+    }
+    /** waits for the next completion. timeout is ignored before Linux 5.11, except that a
+     * timeout already reached doesn't wait.
+     * @return false if timeout was reached first */
+    bool waitForCompletion(std::size_t &bufferIndex,
+                           int &result,
+                           const std::chrono::steady_clock::time_point *timeout)
+    {
+        while(true)
+        {
+            unsigned head = *completionHead; // only this thread moves the head
+            if(head != __atomic_load_n(completionTail, __ATOMIC_ACQUIRE))
+            {
+                const ::io_uring_cqe &completion = completions[head & completionMask];
+                bufferIndex = static_cast<std::size_t>(completion.user_data);
+                result = completion.res;
+                __atomic_store_n(completionHead, head + 1, __ATOMIC_RELEASE);
+                return true;
+            }
+            unsigned flags = IORING_ENTER_GETEVENTS;
+            const void *argument = nullptr;
+            std::size_t argumentSize = 0;
+            if(timeout)
+            {
+                auto remaining = *timeout - std::chrono::steady_clock::now();
+                if(remaining <= std::chrono::steady_clock::duration::zero())
+                    return false;
+#ifdef IORING_FEAT_EXT_ARG
+                ::__kernel_timespec timeLimit;
+                ::io_uring_getevents_arg getEventsArgument;
+                if(canTimeOut)
+                {
+                    auto nanoseconds =
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(remaining).count();
+                    timeLimit.tv_sec = nanoseconds / 1000000000L;
+                    timeLimit.tv_nsec = nanoseconds % 1000000000L;
+                    std::memset(&getEventsArgument, 0, sizeof(getEventsArgument));
+                    getEventsArgument.ts = reinterpret_cast<std::uintptr_t>(&timeLimit);
+                    flags |= IORING_ENTER_EXT_ARG;
+                    argument = &getEventsArgument;
+                    argumentSize = sizeof(getEventsArgument);
+                }
+#endif
+            }
+            if(enter(queuedCount, 1, flags, argument, argumentSize) < 0)
+            {
+                if(errno == ETIME)
+                    return false;
+                if(errno == EINTR)
+                    continue;
+                int error = errno;
+                throw IOError(error, std::generic_category(), "io_uring_enter failed");
+            }
+            queuedCount = 0;
+        }
+    }
+};
+#endif
+
+struct FileBuffer final
+{
+    std::unique_ptr<unsigned char[]> data;
+    /** the remaining part of the read or write in flight */
+    ::iovec request;
+    std::uint64_t offset = 0;
+    /** the number of bytes to read or write */
+    std::size_t length = 0;
+    std::size_t transferred = 0;
+    /** how much of the data read the consumer has taken */
+    std::size_t position = 0;
+    bool inFlight = false;
+    int error = 0;
+    explicit FileBuffer(std::size_t size) : data(new unsigned char[size])
+    {
+        request.iov_base = data.get();
+        request.iov_len = 0;
+    }
+};
+
+/** the buffers and the io_uring or executor shared by reading and writing */
+struct BackgroundFile : public std::enable_shared_from_this<BackgroundFile>
+{
+    const bool isWrite;
+    int fd;
+    util::Executor &executor;
+    std::size_t bufferSize;
+    std::mutex lock;
+    /** notified when a read or write on executor finishes */
+    std::condition_variable completionCond;
+    std::vector<FileBuffer> buffers;
+    std::size_t inFlightCount = 0;
+#ifdef __NR_io_uring_setup
+    std::unique_ptr<IOURing> ring;
+#endif
+    BackgroundFile(bool isWrite,
+                   const std::string &fileName,
+                   std::size_t bufferCount,
+                   std::size_t bufferSize,
+                   util::Executor &executor)
+        : isWrite(isWrite), fd(-1), executor(executor), bufferSize(bufferSize)
+    {
+        if(this->bufferSize == 0)
+            this->bufferSize = 1;
+        else if(this->bufferSize > maxBufferSize)
+            this->bufferSize = maxBufferSize;
+        if(bufferCount > maxBufferCount)
+            bufferCount = maxBufferCount;
+        int flags = isWrite ? O_WRONLY | O_CREAT | O_TRUNC : O_RDONLY;
+        do
+        {
+            fd = ::open(fileName.c_str(), flags | O_CLOEXEC, 0666);
+        } while(fd < 0 && errno == EINTR);
+        if(fd < 0)
+        {
+            int error = errno;
+            throw IOError(error, std::generic_category(), "open failed: " + fileName);
+        }
+        try
+        {
+            buffers.reserve(bufferCount);
+            for(std::size_t i = 0; i < bufferCount; i++)
+                buffers.emplace_back(this->bufferSize);
+#ifdef __NR_io_uring_setup
+            std::vector<::iovec> registeredBuffers;
+            registeredBuffers.reserve(bufferCount);
+            for(FileBuffer &buffer : buffers)
+            {
+                ::iovec registeredBuffer;
+                registeredBuffer.iov_base = buffer.data.get();
+                registeredBuffer.iov_len = this->bufferSize;
+                registeredBuffers.push_back(registeredBuffer);
+            }
+            ring = IOURing::create(registeredBuffers);
+#endif
+        }
+        catch(...)
+        {
+            ::close(fd);
+            throw;
+        }
+    }
+    virtual ~BackgroundFile()
+    {
+#ifdef __NR_io_uring_setup
+        if(ring)
+        {
+            std::unique_lock<std::mutex> lockIt(lock);
+            try
+            {
+                while(inFlightCount > 0)
+                    waitForCompletion(lockIt, nullptr);
+            }
+            catch(...)
+            {
+                // the kernel may still write to the buffers, so they must never be freed
+                for(FileBuffer &buffer : buffers)
+                    buffer.data.release();
+            }
+            ring = nullptr;
+        }
+#endif
+        if(fd >= 0)
+            ::close(fd);
+    }
+    bool usesIOURing() const noexcept
+    {
+#ifdef __NR_io_uring_setup
+        return ring != nullptr;
+#else
+        return false;
+#endif
+    }
+    void finish(FileBuffer &buffer)
+    {
+        buffer.inFlight = false;
+        inFlightCount--;
+        completionCond.notify_all();
+    }
+#ifdef __NR_io_uring_setup
+    void queueOnRing(std::size_t bufferIndex)
+    {
+        FileBuffer &buffer = buffers[bufferIndex];
+        buffer.request.iov_base = buffer.data.get() + buffer.transferred;
+        buffer.request.iov_len = buffer.length - buffer.transferred;
+        ring->queue(isWrite, fd, bufferIndex, buffer.request, buffer.offset + buffer.transferred);
+    }
+    /** records a completion, then queues the rest of the request if it came up short */
+    void handleRingResult(std::size_t bufferIndex, int result)
+    {
+        FileBuffer &buffer = buffers[bufferIndex];
+        if(result == -EINTR || result == -EAGAIN)
+        {
+            queueOnRing(bufferIndex);
+            ring->submit();
+            return;
+        }
+        if(result < 0)
+        {
+            buffer.error = -result;
+        }
+        else if(result == 0)
+        {
+            if(isWrite)
+                buffer.error = EIO;
+        }
+        else
+        {
+            buffer.transferred += result;
+            if(buffer.transferred < buffer.length)
+            {
+                queueOnRing(bufferIndex);
+                ring->submit();
+                return;
+            }
+        }
+        finish(buffer);
+    }
+#endif
+    /** runs on executor; reads until the end of the file or the whole buffer is transferred */
+    void transferOnExecutor(std::size_t bufferIndex)
+    {
+        FileBuffer &buffer = buffers[bufferIndex];
+        std::size_t transferred = 0;
+        int error = 0;
+        while(transferred < buffer.length)
+        {
+            auto result =
+                isWrite ? ::pwrite(fd,
+                                   buffer.data.get() + transferred,
+                                   buffer.length - transferred,
+                                   static_cast<::off_t>(buffer.offset + transferred)) :
+                          ::pread(fd,
+                                  buffer.data.get() + transferred,
+                                  buffer.length - transferred,
+                                  static_cast<::off_t>(buffer.offset + transferred));
+            if(result < 0)
+            {
+                if(errno == EINTR)
+                    continue;
+                error = errno;
+                break;
+            }
+            if(result == 0)
+            {
+                if(isWrite)
+                    error = EIO;
+                break;
+            }
+            transferred += result;
+        }
+        std::unique_lock<std::mutex> lockIt(lock);
+        buffer.transferred = transferred;
+        buffer.error = error;
+        finish(buffer);
+    }
+    /** starts transferring buffer bufferIndex, of length bytes at offset. Call with lock held.
+     * With an io_uring, the request is only queued until submitQueued. */
+    void queue(std::size_t bufferIndex)
+    {
+        FileBuffer &buffer = buffers[bufferIndex];
+        buffer.transferred = 0;
+        buffer.error = 0;
+        buffer.inFlight = true;
+        inFlightCount++;
+#ifdef __NR_io_uring_setup
+        if(ring)
+        {
+            queueOnRing(bufferIndex);
+            return;
+        }
+#endif
+        auto self = shared_from_this();
+        try
+        {
+            executor.execute([self, bufferIndex]()
+                             {
+                                 self->transferOnExecutor(bufferIndex);
+                             });
+        }
+        catch(...)
+        {
+            buffer.inFlight = false;
+            inFlightCount--;
+            throw;
+        }
+    }
+    void submitQueued()
+    {
+#ifdef __NR_io_uring_setup
+        if(ring)
+            ring->submit();
+#endif
+    }
+    /** waits until a read or write finishes
+     * @return false if timeout was reached first */
+    bool waitForCompletion(std::unique_lock<std::mutex> &lockIt,
+                           const std::chrono::steady_clock::time_point *timeout)
+    {
+#ifdef __NR_io_uring_setup
+        if(ring)
+        {
+            std::size_t bufferIndex;
+            int result;
+            if(!ring->waitForCompletion(bufferIndex, result, timeout))
+                return false;
+            constexprAssert(bufferIndex < buffers.size());
+            handleRingResult(bufferIndex, result);
+            return true;
+        }
+#endif
+        if(!timeout)
+        {
+            completionCond.wait(lockIt);
+            return true;
+        }
+        return completionCond.wait_until(lockIt, *timeout) == std::cv_status::no_timeout;
+    }
+};
+}
+
+struct ReadAheadFileInputStream::Implementation final : public BackgroundFile
+{
+    std::deque<std::size_t> freeBuffers;
+    /** the buffers being read or holding unread data, in file order */
+    std::deque<std::size_t> readBuffers;
+    std::uint64_t nextOffset = 0;
+    /** the consumer reached the end of the file or a read error */
+    bool finished = false;
+    Implementation(const std::string &fileName,
+                   std::size_t bufferCount,
+                   std::size_t bufferSize,
+                   util::Executor &executor)
+        : BackgroundFile(false, fileName, bufferCount > 0 ? bufferCount : 1, bufferSize, executor)
+    {
+        for(std::size_t i = 0; i < buffers.size(); i++)
+            freeBuffers.push_back(i);
+    }
+    /** @return true if a finished read came up short, so the file ends before nextOffset */
+    bool foundEnd() const
+    {
+        for(std::size_t bufferIndex : readBuffers)
+        {
+            const FileBuffer &buffer = buffers[bufferIndex];
+            if(!buffer.inFlight && (buffer.error != 0 || buffer.transferred < buffer.length))
+                return true;
+        }
+        return false;
+    }
+    void startReads()
+    {
+        if(freeBuffers.empty() || foundEnd())
+            return;
+        while(!freeBuffers.empty())
+        {
+            std::size_t bufferIndex = freeBuffers.front();
+            FileBuffer &buffer = buffers[bufferIndex];
+            buffer.offset = nextOffset;
+            buffer.length = bufferSize;
+            buffer.position = 0;
+            queue(bufferIndex);
+            freeBuffers.pop_front();
+            readBuffers.push_back(bufferIndex);
+            nextOffset += bufferSize;
+        }
+        submitQueued();
+    }
+    ReadBytesResult read(unsigned char *readBuffer,
+                         std::size_t readBufferSize,
+                         const std::chrono::steady_clock::time_point *timeout)
+    {
+        std::unique_lock<std::mutex> lockIt(lock);
+        std::size_t readCount = 0;
+        while(readCount < readBufferSize && !finished)
+        {
+            if(readBuffers.empty())
+            {
+                startReads();
+                continue;
+            }
+            std::size_t bufferIndex = readBuffers.front();
+            FileBuffer &buffer = buffers[bufferIndex];
+            if(buffer.inFlight)
+            {
+                if(!waitForCompletion(lockIt, timeout))
+                    break;
+                continue;
+            }
+            if(buffer.error != 0)
+            {
+                if(readCount > 0)
+                    break;
+                finished = true;
+                throw IOError(buffer.error, std::generic_category(), "read failed");
+            }
+            std::size_t copyCount = buffer.transferred - buffer.position;
+            if(copyCount > readBufferSize - readCount)
+                copyCount = readBufferSize - readCount;
+            std::memcpy(readBuffer + readCount, buffer.data.get() + buffer.position, copyCount);
+            buffer.position += copyCount;
+            readCount += copyCount;
+            if(buffer.position == buffer.transferred)
+            {
+                readBuffers.pop_front();
+                freeBuffers.push_back(bufferIndex);
+                // a short read means the file ends here; the reads after it are discarded
+                if(buffer.transferred < buffer.length)
+                    finished = true;
+                else
+                    startReads();
+            }
+        }
+        return ReadBytesResult(readCount, finished);
+    }
+};
+
+ReadAheadFileInputStream::ReadAheadFileInputStream(std::string fileName,
+                                                   std::size_t bufferCount,
+                                                   std::size_t bufferSize,
+                                                   util::Executor &executor)
+    : implementation(std::make_shared<Implementation>(fileName, bufferCount, bufferSize, executor))
+{
+    std::unique_lock<std::mutex> lockIt(implementation->lock);
+    implementation->startReads();
+}
+
+ReadAheadFileInputStream::~ReadAheadFileInputStream()
+{
+}
+
+ReadAheadFileInputStream::ReadBytesResult ReadAheadFileInputStream::readBytes(
+    unsigned char *buffer,
+    std::size_t bufferSize,
+    const std::chrono::steady_clock::time_point *timeout)
+{
+    if(!implementation)
+        return ReadBytesResult(0, true);
+    return implementation->read(buffer, bufferSize, timeout);
+}
+
+bool ReadAheadFileInputStream::usesIOURing() const noexcept
+{
+    return implementation && implementation->usesIOURing();
+}
+
+struct WriteBehindFileOutputStream::Implementation final : public BackgroundFile
+{
+    std::deque<std::size_t> freeBuffers;
+    std::deque<std::size_t> writingBuffers;
+    std::size_t currentBuffer = 0;
+    std::uint64_t nextOffset = 0;
+    int error = 0;
+    Implementation(const std::string &fileName,
+                   std::size_t bufferCount,
+                   std::size_t bufferSize,
+                   util::Executor &executor)
+        : BackgroundFile(true, fileName, bufferCount > 2 ? bufferCount : 2, bufferSize, executor)
+    {
+        for(std::size_t i = 1; i < buffers.size(); i++)
+            freeBuffers.push_back(i);
+    }
+    /** frees the buffers whose writes finished, keeping the first error */
+    void collectFinishedWrites()
+    {
+        for(std::size_t i = 0; i < writingBuffers.size();)
+        {
+            FileBuffer &buffer = buffers[writingBuffers[i]];
+            if(buffer.inFlight)
+            {
+                i++;
+                continue;
+            }
+            if(error == 0)
+                error = buffer.error;
+            freeBuffers.push_back(writingBuffers[i]);
+            writingBuffers.erase(writingBuffers.begin() + i);
+        }
+    }
+    void checkError()
+    {
+        collectFinishedWrites();
+        if(error != 0)
+        {
+            int rethrownError = error;
+            error = 0;
+            throw IOError(rethrownError, std::generic_category(), "write failed");
+        }
+    }
+    void submitCurrentBuffer(std::unique_lock<std::mutex> &lockIt)
+    {
+        FileBuffer &buffer = buffers[currentBuffer];
+        buffer.offset = nextOffset;
+        queue(currentBuffer);
+        submitQueued();
+        nextOffset += buffer.length;
+        writingBuffers.push_back(currentBuffer);
+        collectFinishedWrites();
+        while(freeBuffers.empty())
+        {
+            waitForCompletion(lockIt, nullptr);
+            collectFinishedWrites();
+        }
+        currentBuffer = freeBuffers.front();
+        freeBuffers.pop_front();
+        buffers[currentBuffer].length = 0;
+    }
+    void write(const unsigned char *writeBuffer, std::size_t writeBufferSize)
+    {
+        std::unique_lock<std::mutex> lockIt(lock);
+        constexprAssert(fd >= 0);
+        checkError();
+        while(writeBufferSize > 0)
+        {
+            FileBuffer &buffer = buffers[currentBuffer];
+            std::size_t copyCount = bufferSize - buffer.length;
+            if(copyCount > writeBufferSize)
+                copyCount = writeBufferSize;
+            std::memcpy(buffer.data.get() + buffer.length, writeBuffer, copyCount);
+            buffer.length += copyCount;
+            writeBuffer += copyCount;
+            writeBufferSize -= copyCount;
+            if(buffer.length == bufferSize)
+                submitCurrentBuffer(lockIt);
+        }
+    }
+    void flush()
+    {
+        std::unique_lock<std::mutex> lockIt(lock);
+        if(fd < 0)
+            return;
+        if(buffers[currentBuffer].length > 0)
+            submitCurrentBuffer(lockIt);
+        while(inFlightCount > 0)
+            waitForCompletion(lockIt, nullptr);
+        checkError();
+    }
+    void close()
+    {
+        flush();
+        std::unique_lock<std::mutex> lockIt(lock);
+        if(fd < 0)
+            return;
+        int result = ::close(fd);
+        fd = -1;
+        if(result != 0 && errno != EINTR)
+            throw IOError(errno, std::generic_category(), "close failed");
+    }
+};
+
+WriteBehindFileOutputStream::WriteBehindFileOutputStream(std::string fileName,
+                                                         std::size_t bufferCount,
+                                                         std::size_t bufferSize,
+                                                         util::Executor &executor)
+    : implementation(std::make_shared<Implementation>(fileName, bufferCount, bufferSize, executor))
+{
+}
+
+WriteBehindFileOutputStream::~WriteBehindFileOutputStream()
+{
+    if(!implementation)
+        return;
+    try
+    {
+        implementation->flush();
+    }
+    catch(...)
+    {
+    }
+}
+
+void WriteBehindFileOutputStream::writeBytes(const unsigned char *buffer, std::size_t bufferSize)
+{
+    constexprAssert(implementation);
+    implementation->write(buffer, bufferSize);
+}
+
+void WriteBehindFileOutputStream::flush()
+{
+    if(implementation)
+        implementation->flush();
+}
+
+bool WriteBehindFileOutputStream::usesIOURing() const noexcept
+{
+    return implementation && implementation->usesIOURing();
+}
+
+void WriteBehindFileOutputStream::close()
+{
+    if(implementation)
+        implementation->close();
+}
+}
+}
+}
+#endif
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#ifndef IO_BACKGROUND_FILE_STREAM_H_
+#define IO_BACKGROUND_FILE_STREAM_H_
+
+#include "input_stream.h"
+#include "output_stream.h"
+#include "../util/executor.h"
+#include <memory>
+#include <string>
+#include <utility>
+
+#ifndef _WIN32
+namespace programmerjake
+{
+namespace voxels
+{
+namespace io
+{
+/** reads a file with up to bufferCount reads in flight ahead of the consumer, each filling one
+ * buffer at the next offset. On Linux the reads go through an io_uring with the buffers
+ * registered with the kernel. Where io_uring isn't available, each read is a pread task on
+ * executor instead.
+ */
+class ReadAheadFileInputStream final : public InputStream
+{
+public:
+    static constexpr std::size_t defaultBufferCount = 8;
+    static constexpr std::size_t defaultBufferSize = 0x10000;
+
+private:
+    struct Implementation;
+
+private:
+    std::shared_ptr<Implementation> implementation;
+
+public:
+    explicit ReadAheadFileInputStream(
+        std::string fileName,
+        std::size_t bufferCount = defaultBufferCount,
+        std::size_t bufferSize = defaultBufferSize,
+        util::Executor &executor = util::ThreadPoolExecutor::getBlockingIOExecutor());
+    /** with an io_uring, waits for the reads in flight, since the kernel writes straight into
+     * the buffers */
+    virtual ~ReadAheadFileInputStream();
+    ReadAheadFileInputStream(ReadAheadFileInputStream &&rt) noexcept
+        : InputStream(std::move(rt)),
+          implementation(std::move(rt.implementation))
+    {
+    }
+    ReadAheadFileInputStream &operator=(ReadAheadFileInputStream rt) noexcept
+    {
+        InputStream::operator=(std::move(rt));
+        std::swap(implementation, rt.implementation);
+        return *this;
+    }
+    /** honors timeout while waiting for the next buffer, except with an io_uring on kernels
+     * older than 5.11 */
+    virtual ReadBytesResult readBytes(
+        unsigned char *buffer,
+        std::size_t bufferSize,
+        const std::chrono::steady_clock::time_point *timeout) override;
+    /** @return true if the reads go through an io_uring rather than executor */
+    bool usesIOURing() const noexcept;
+};
+
+/** writes a file with up to bufferCount writes in flight behind the producer, each writing one
+ * full buffer at the next offset. Like ReadAheadFileInputStream, it uses an io_uring with
+ * registered buffers on Linux and pwrite tasks on executor elsewhere.
+ */
+class WriteBehindFileOutputStream final : public OutputStream
+{
+public:
+    static constexpr std::size_t defaultBufferCount = 8;
+    static constexpr std::size_t defaultBufferSize = 0x10000;
+
+private:
+    struct Implementation;
+
+private:
+    std::shared_ptr<Implementation> implementation;
+
+public:
+    /** creates or truncates fileName */
+    explicit WriteBehindFileOutputStream(
+        std::string fileName,
+        std::size_t bufferCount = defaultBufferCount,
+        std::size_t bufferSize = defaultBufferSize,
+        util::Executor &executor = util::ThreadPoolExecutor::getBlockingIOExecutor());
+    /** writes out any remaining data; errors are ignored, call close first to see them */
+    virtual ~WriteBehindFileOutputStream();
+    WriteBehindFileOutputStream(WriteBehindFileOutputStream &&rt) noexcept
+        : OutputStream(std::move(rt)),
+          implementation(std::move(rt.implementation))
+    {
+    }
+    WriteBehindFileOutputStream &operator=(WriteBehindFileOutputStream rt) noexcept
+    {
+        OutputStream::operator=(std::move(rt));
+        std::swap(implementation, rt.implementation);
+        return *this;
+    }
+    /** errors from earlier writes are rethrown here */
+    virtual void writeBytes(const unsigned char *buffer, std::size_t bufferSize) override;
+    /** waits for all buffered data to be written */
+    virtual void flush() override;
+    /** @return true if the writes go through an io_uring rather than executor */
+    bool usesIOURing() const noexcept;
+    void close();
+};
+}
+}
+}
+#endif
+
+#endif /* IO_BACKGROUND_FILE_STREAM_H_ */
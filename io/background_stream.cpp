@@ -0,0 +1,376 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#include "background_stream.h"
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <exception>
+#include <cstring>
+#include "../util/constexpr_assert.h"
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace io
+{
+namespace
+{
+/** how long a background read waits for data before giving its thread back */
+constexpr std::chrono::milliseconds readSliceDuration(50);
+
+struct Buffer final
+{
+    std::unique_ptr<unsigned char[]> data;
+    std::size_t used = 0;
+    std::size_t position = 0;
+    explicit Buffer(std::size_t size) : data(new unsigned char[size])
+    {
+    }
+};
+}
+
+/** shared with the read task, so it can outlive the stream */
+struct ReadAheadInputStream::Implementation final
+    : public std::enable_shared_from_this<Implementation>
+{
+    std::shared_ptr<InputStream> stream;
+    util::Executor &executor;
+    std::size_t bufferSize;
+    std::mutex lock;
+    std::condition_variable consumerCond;
+    std::vector<Buffer> buffers;
+    std::deque<std::size_t> freeBuffers;
+    std::deque<std::size_t> filledBuffers;
+    bool reading = false;
+    bool streamHitEOF = false;
+    bool stopRequested = false;
+    std::exception_ptr error;
+    Implementation(std::shared_ptr<InputStream> stream,
+                   std::size_t bufferCount,
+                   std::size_t bufferSize,
+                   util::Executor &executor)
+        : stream(std::move(stream)), executor(executor), bufferSize(bufferSize > 0 ? bufferSize : 1)
+    {
+        if(bufferCount == 0)
+            bufferCount = 1;
+        buffers.reserve(bufferCount);
+        for(std::size_t i = 0; i < bufferCount; i++)
+        {
+            buffers.emplace_back(this->bufferSize);
+            freeBuffers.push_back(i);
+        }
+    }
+    /** starts a task to fill the free buffers unless one is already queued or running */
+    void startReading()
+    {
+        if(reading || stopRequested || streamHitEOF || error || freeBuffers.empty())
+            return;
+        auto self = shared_from_this();
+        executor.execute([self]()
+                         {
+                             self->readSlice();
+                         });
+        reading = true;
+    }
+    /** reads into one free buffer for at most readSliceDuration, then queues the next slice as a
+     * new task so other streams get a turn */
+    void readSlice()
+    {
+        std::unique_lock<std::mutex> lockIt(lock);
+        if(stopRequested)
+        {
+            reading = false;
+            return;
+        }
+        std::size_t bufferIndex = freeBuffers.front();
+        freeBuffers.pop_front();
+        Buffer &buffer = buffers[bufferIndex];
+        lockIt.unlock();
+        ReadBytesResult result(0, false);
+        std::exception_ptr readError;
+        try
+        {
+            auto timeout = std::chrono::steady_clock::now() + readSliceDuration;
+            result = stream->readBytes(buffer.data.get(), bufferSize, &timeout);
+        }
+        catch(...)
+        {
+            readError = std::current_exception();
+        }
+        lockIt.lock();
+        buffer.used = readError ? 0 : result.readCount;
+        buffer.position = 0;
+        if(buffer.used > 0)
+            filledBuffers.push_back(bufferIndex);
+        else
+            freeBuffers.push_front(bufferIndex);
+        if(readError)
+            error = readError;
+        if(result.hitEOF)
+            streamHitEOF = true;
+        consumerCond.notify_all();
+        reading = false;
+        startReading();
+    }
+    void stop()
+    {
+        std::unique_lock<std::mutex> lockIt(lock);
+        stopRequested = true;
+    }
+    ReadBytesResult read(unsigned char *readBuffer,
+                         std::size_t readBufferSize,
+                         const std::chrono::steady_clock::time_point *timeout)
+    {
+        std::unique_lock<std::mutex> lockIt(lock);
+        std::size_t readCount = 0;
+        while(readCount < readBufferSize)
+        {
+            if(filledBuffers.empty())
+            {
+                if(streamHitEOF || error || readCount > 0)
+                    break;
+                if(timeout)
+                {
+                    if(consumerCond.wait_until(lockIt, *timeout) == std::cv_status::timeout
+                       && filledBuffers.empty())
+                        break;
+                }
+                else
+                {
+                    consumerCond.wait(lockIt);
+                }
+                continue;
+            }
+            Buffer &buffer = buffers[filledBuffers.front()];
+            std::size_t copyCount = buffer.used - buffer.position;
+            if(copyCount > readBufferSize - readCount)
+                copyCount = readBufferSize - readCount;
+            std::memcpy(readBuffer + readCount, buffer.data.get() + buffer.position, copyCount);
+            buffer.position += copyCount;
+            readCount += copyCount;
+            if(buffer.position == buffer.used)
+            {
+                freeBuffers.push_back(filledBuffers.front());
+                filledBuffers.pop_front();
+                startReading();
+            }
+        }
+        if(filledBuffers.empty() && error && readCount == 0)
+        {
+            auto rethrownError = error;
+            error = nullptr;
+            streamHitEOF = true;
+            std::rethrow_exception(rethrownError);
+        }
+        return ReadBytesResult(readCount, filledBuffers.empty() && streamHitEOF);
+    }
+};
+
+ReadAheadInputStream::ReadAheadInputStream(std::shared_ptr<InputStream> stream,
+                                           std::size_t bufferCount,
+                                           std::size_t bufferSize,
+                                           util::Executor &executor)
+    : implementation(
+          std::make_shared<Implementation>(std::move(stream), bufferCount, bufferSize, executor))
+{
+    std::unique_lock<std::mutex> lockIt(implementation->lock);
+    implementation->startReading();
+}
+
+ReadAheadInputStream::~ReadAheadInputStream()
+{
+    if(implementation)
+        implementation->stop();
+}
+
+ReadAheadInputStream::ReadBytesResult ReadAheadInputStream::readBytes(
+    unsigned char *buffer,
+    std::size_t bufferSize,
+    const std::chrono::steady_clock::time_point *timeout)
+{
+    if(!implementation)
+        return ReadBytesResult(0, true);
+    return implementation->read(buffer, bufferSize, timeout);
+}
+
+struct WriteBehindOutputStream::Implementation final
+    : public std::enable_shared_from_this<Implementation>
+{
+    std::shared_ptr<OutputStream> stream;
+    util::Executor &executor;
+    std::size_t bufferSize;
+    std::mutex lock;
+    std::condition_variable producerCond;
+    std::vector<Buffer> buffers;
+    std::deque<std::size_t> freeBuffers;
+    std::deque<std::size_t> filledBuffers;
+    std::size_t currentBuffer;
+    bool writing = false;
+    std::exception_ptr error;
+    Implementation(std::shared_ptr<OutputStream> stream,
+                   std::size_t bufferCount,
+                   std::size_t bufferSize,
+                   util::Executor &executor)
+        : stream(std::move(stream)), executor(executor), bufferSize(bufferSize > 0 ? bufferSize : 1)
+    {
+        if(bufferCount < 2)
+            bufferCount = 2;
+        buffers.reserve(bufferCount);
+        for(std::size_t i = 0; i < bufferCount; i++)
+        {
+            buffers.emplace_back(this->bufferSize);
+            if(i != 0)
+                freeBuffers.push_back(i);
+        }
+        currentBuffer = 0;
+    }
+    /** starts a task to write the filled buffers unless one is already running */
+    void startWriting()
+    {
+        if(writing || filledBuffers.empty())
+            return;
+        auto self = shared_from_this();
+        executor.execute([self]()
+                         {
+                             self->writeFilledBuffers();
+                         });
+        writing = true;
+    }
+    void writeFilledBuffers()
+    {
+        std::unique_lock<std::mutex> lockIt(lock);
+        while(!filledBuffers.empty())
+        {
+            std::size_t bufferIndex = filledBuffers.front();
+            Buffer &buffer = buffers[bufferIndex];
+            bool hasError = static_cast<bool>(error);
+            lockIt.unlock();
+            std::exception_ptr writeError;
+            if(!hasError)
+            {
+                try
+                {
+                    stream->writeBytes(buffer.data.get(), buffer.used);
+                }
+                catch(...)
+                {
+                    writeError = std::current_exception();
+                }
+            }
+            buffer.used = 0;
+            lockIt.lock();
+            if(writeError)
+                error = writeError;
+            filledBuffers.pop_front();
+            freeBuffers.push_back(bufferIndex);
+            producerCond.notify_all();
+        }
+        writing = false;
+        producerCond.notify_all();
+    }
+    void checkError()
+    {
+        if(error)
+        {
+            auto rethrownError = error;
+            error = nullptr;
+            std::rethrow_exception(rethrownError);
+        }
+    }
+    void submitCurrentBuffer(std::unique_lock<std::mutex> &lockIt)
+    {
+        filledBuffers.push_back(currentBuffer);
+        startWriting();
+        while(freeBuffers.empty())
+            producerCond.wait(lockIt);
+        currentBuffer = freeBuffers.front();
+        freeBuffers.pop_front();
+    }
+    void write(const unsigned char *writeBuffer, std::size_t writeBufferSize)
+    {
+        std::unique_lock<std::mutex> lockIt(lock);
+        checkError();
+        while(writeBufferSize > 0)
+        {
+            Buffer &buffer = buffers[currentBuffer];
+            std::size_t copyCount = bufferSize - buffer.used;
+            if(copyCount > writeBufferSize)
+                copyCount = writeBufferSize;
+            std::memcpy(buffer.data.get() + buffer.used, writeBuffer, copyCount);
+            buffer.used += copyCount;
+            writeBuffer += copyCount;
+            writeBufferSize -= copyCount;
+            if(buffer.used == bufferSize)
+                submitCurrentBuffer(lockIt);
+        }
+    }
+    void flush(bool flushStream)
+    {
+        std::unique_lock<std::mutex> lockIt(lock);
+        if(buffers[currentBuffer].used > 0)
+            submitCurrentBuffer(lockIt);
+        while(!filledBuffers.empty() || writing)
+            producerCond.wait(lockIt);
+        checkError();
+        lockIt.unlock();
+        if(flushStream)
+            stream->flush();
+    }
+};
+
+WriteBehindOutputStream::WriteBehindOutputStream(std::shared_ptr<OutputStream> stream,
+                                                 std::size_t bufferCount,
+                                                 std::size_t bufferSize,
+                                                 util::Executor &executor)
+    : implementation(
+          std::make_shared<Implementation>(std::move(stream), bufferCount, bufferSize, executor))
+{
+}
+
+WriteBehindOutputStream::~WriteBehindOutputStream()
+{
+    if(!implementation)
+        return;
+    try
+    {
+        implementation->flush(false);
+    }
+    catch(...)
+    {
+    }
+}
+
+void WriteBehindOutputStream::writeBytes(const unsigned char *buffer, std::size_t bufferSize)
+{
+    constexprAssert(implementation);
+    implementation->write(buffer, bufferSize);
+}
+
+void WriteBehindOutputStream::flush()
+{
+    if(implementation)
+        implementation->flush(true);
+}
+}
+}
+}
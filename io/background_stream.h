@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#ifndef IO_BACKGROUND_STREAM_H_
+#define IO_BACKGROUND_STREAM_H_
+
+#include "input_stream.h"
+#include "output_stream.h"
+#include "../util/executor.h"
+#include <memory>
+#include <utility>
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace io
+{
+/** reads up to bufferCount buffers ahead of the consumer as tasks on executor. Each task waits for
+ * data for at most a short slice before giving its thread back, so idle and destroyed streams
+ * don't hold threads, as long as the underlying stream honors readBytes' timeout. Whatever each
+ * read returns is passed on at once, without waiting for a full buffer. The underlying stream is
+ * read one call at a time; ReadAheadFileInputStream keeps several reads of a file in flight.
+ * executor must outlive the reads, which can finish after this stream is destroyed.
+ */
+class ReadAheadInputStream final : public InputStream
+{
+public:
+    static constexpr std::size_t defaultBufferCount = 4;
+    static constexpr std::size_t defaultBufferSize = 0x10000;
+
+private:
+    struct Implementation;
+
+private:
+    std::shared_ptr<Implementation> implementation;
+
+public:
+    explicit ReadAheadInputStream(
+        std::shared_ptr<InputStream> stream,
+        std::size_t bufferCount = defaultBufferCount,
+        std::size_t bufferSize = defaultBufferSize,
+        util::Executor &executor = util::ThreadPoolExecutor::getBlockingIOExecutor());
+    /** doesn't wait for a read in progress; it stops at the end of its slice */
+    virtual ~ReadAheadInputStream();
+    ReadAheadInputStream(ReadAheadInputStream &&rt) noexcept
+        : InputStream(std::move(rt)),
+          implementation(std::move(rt.implementation))
+    {
+    }
+    ReadAheadInputStream &operator=(ReadAheadInputStream rt) noexcept
+    {
+        InputStream::operator=(std::move(rt));
+        std::swap(implementation, rt.implementation);
+        return *this;
+    }
+    /** honors timeout while waiting for the read ahead; errors from the underlying stream are
+     * rethrown here */
+    virtual ReadBytesResult readBytes(
+        unsigned char *buffer,
+        std::size_t bufferSize,
+        const std::chrono::steady_clock::time_point *timeout) override;
+};
+
+/** writes to the underlying stream as tasks on executor, with up to bufferCount buffers in
+ * flight. A task only runs while there's data to write, so idle streams don't hold threads. */
+class WriteBehindOutputStream final : public OutputStream
+{
+public:
+    static constexpr std::size_t defaultBufferCount = 4;
+    static constexpr std::size_t defaultBufferSize = 0x10000;
+
+private:
+    struct Implementation;
+
+private:
+    std::shared_ptr<Implementation> implementation;
+
+public:
+    /** @param executor runs the writes, so its threads must be allowed to block */
+    explicit WriteBehindOutputStream(
+        std::shared_ptr<OutputStream> stream,
+        std::size_t bufferCount = defaultBufferCount,
+        std::size_t bufferSize = defaultBufferSize,
+        util::Executor &executor = util::ThreadPoolExecutor::getBlockingIOExecutor());
+    /** writes out any remaining data; errors are ignored, call flush first to see them */
+    virtual ~WriteBehindOutputStream();
+    WriteBehindOutputStream(WriteBehindOutputStream &&rt) noexcept
+        : OutputStream(std::move(rt)),
+          implementation(std::move(rt.implementation))
+    {
+    }
+    WriteBehindOutputStream &operator=(WriteBehindOutputStream rt) noexcept
+    {
+        OutputStream::operator=(std::move(rt));
+        std::swap(implementation, rt.implementation);
+        return *this;
+    }
+    /** errors from earlier background writes are rethrown here */
+    virtual void writeBytes(const unsigned char *buffer, std::size_t bufferSize) override;
+    /** waits for all buffered data to be written then flushes the underlying stream */
+    virtual void flush() override;
+};
+}
+}
+}
+
+#endif /* IO_BACKGROUND_STREAM_H_ */
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#ifndef IO_BUFFERED_STREAM_H_
+#define IO_BUFFERED_STREAM_H_
+
+#include "input_stream.h"
+#include <memory>
+#include <vector>
+#include <cstring>
+#include "../util/constexpr_assert.h"
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace io
+{
+/** reads through a buffer so that any stream can provide peekContiguous */
+class BufferedInputStream final : public InputStream
+{
+public:
+    static constexpr std::size_t defaultBufferSize = 0x10000;
+
+private:
+    std::shared_ptr<InputStream> stream;
+    std::vector<unsigned char> buffer;
+    std::size_t bufferStart;
+    std::size_t bufferEnd;
+    bool streamHitEOF;
+
+private:
+    void fillBuffer(const std::chrono::steady_clock::time_point *timeout)
+    {
+        bufferStart = 0;
+        bufferEnd = 0;
+        if(streamHitEOF)
+            return;
+        auto result = stream->readBytes(buffer.data(), buffer.size(), timeout);
+        constexprAssert(result.readCount <= buffer.size());
+        bufferEnd = result.readCount;
+        streamHitEOF = result.hitEOF;
+    }
+
+public:
+    explicit BufferedInputStream(std::shared_ptr<InputStream> stream,
+                                 std::size_t bufferSize = defaultBufferSize)
+        : stream(std::move(stream)),
+          buffer(bufferSize > 0 ? bufferSize : 1),
+          bufferStart(0),
+          bufferEnd(0),
+          streamHitEOF(false)
+    {
+    }
+    /** @return stream if it can already peekContiguous, otherwise stream wrapped in a
+     * BufferedInputStream
+     */
+    static std::shared_ptr<InputStream> makeContiguous(std::shared_ptr<InputStream> stream,
+                                                       std::size_t bufferSize = defaultBufferSize)
+    {
+        if(stream->canPeekContiguous())
+            return stream;
+        return std::make_shared<BufferedInputStream>(std::move(stream), bufferSize);
+    }
+    virtual ReadBytesResult readBytes(unsigned char *buffer,
+                                      std::size_t bufferSize,
+                                      const std::chrono::steady_clock::time_point *timeout) override
+    {
+        if(bufferStart == bufferEnd && !streamHitEOF)
+        {
+            // large reads bypass the buffer
+            if(bufferSize >= this->buffer.size())
+            {
+                auto result = stream->readBytes(buffer, bufferSize, timeout);
+                streamHitEOF = result.hitEOF;
+                return result;
+            }
+            fillBuffer(timeout);
+        }
+        std::size_t readCount = bufferEnd - bufferStart;
+        if(readCount > bufferSize)
+            readCount = bufferSize;
+        if(readCount > 0)
+            std::memcpy(buffer, this->buffer.data() + bufferStart, readCount);
+        bufferStart += readCount;
+        return ReadBytesResult(readCount, bufferStart == bufferEnd && streamHitEOF);
+    }
+    virtual bool canPeekContiguous() const noexcept override
+    {
+        return true;
+    }
+    virtual PeekContiguousResult peekContiguous() override
+    {
+        while(bufferStart == bufferEnd && !streamHitEOF)
+            fillBuffer(nullptr);
+        return PeekContiguousResult(
+            buffer.data() + bufferStart, bufferEnd - bufferStart, streamHitEOF);
+    }
+    virtual void consume(std::size_t count) override
+    {
+        constexprAssert(count <= bufferEnd - bufferStart);
+        bufferStart += count;
+    }
+    virtual bool isSeekable() const noexcept override
+    {
+        return stream->isSeekable();
+    }
+    virtual void seek(std::uint64_t position) override
+    {
+        stream->seek(position);
+        bufferStart = 0;
+        bufferEnd = 0;
+        streamHitEOF = false;
+    }
+    virtual std::uint64_t tell() override
+    {
+        return stream->tell() - (bufferEnd - bufferStart);
+    }
+    virtual std::uint64_t size() override
+    {
+        return stream->size();
+    }
+};
+}
+}
+}
+
+#endif /* IO_BUFFERED_STREAM_H_ */
@@ -23,6 +23,7 @@
 #define IO_CONCAT_STREAM_H_
 
 #include "input_stream.h"
+#include "background_stream.h"
 #include <vector>
 #include <initializer_list>
 #include "../util/constexpr_assert.h"
@@ -35,36 +36,131 @@ namespace io
 {
 class ConcatInputStream final : public InputStream
 {
+public:
+    struct PrefetchOptions final
+    {
+        /** how many streams after the current one are read ahead in the background */
+        std::size_t streamCount;
+        /** the total buffer memory shared by the streams being read ahead; each buffer is at
+         * least 4 KiB */
+        std::size_t memoryLimit;
+        constexpr PrefetchOptions(std::size_t streamCount, std::size_t memoryLimit)
+            : streamCount(streamCount), memoryLimit(memoryLimit)
+        {
+        }
+    };
+
+private:
+    static constexpr std::size_t prefetchBuffersPerStream = 2;
+    static constexpr std::size_t minimumPrefetchBufferSize = 0x1000;
+
 private:
     std::vector<std::shared_ptr<InputStream>> streams;
     std::size_t streamIndex;
+    std::size_t prefetchCount;
+    std::size_t prefetchBufferSize;
+    std::size_t prefetchEnd;
+
+private:
+    void nextStream()
+    {
+        if(prefetchCount > 0)
+            streams[streamIndex].reset(); // free its read-ahead buffers
+        streamIndex++;
+        startPrefetching();
+    }
+    void startPrefetching()
+    {
+        if(prefetchCount == 0)
+            return;
+        if(prefetchEnd <= streamIndex)
+            prefetchEnd = streamIndex + 1;
+        // make_shared takes its arguments by reference, which would need a definition of the
+        // static member
+        std::size_t bufferCount = prefetchBuffersPerStream;
+        for(; prefetchEnd < streams.size() && prefetchEnd <= streamIndex + prefetchCount;
+            prefetchEnd++)
+        {
+            streams[prefetchEnd] = std::make_shared<ReadAheadInputStream>(
+                std::move(streams[prefetchEnd]), bufferCount, prefetchBufferSize);
+        }
+    }
 
 public:
     ConcatInputStream(std::initializer_list<std::shared_ptr<InputStream>> streams)
-        : streams(streams), streamIndex(0)
+        : streams(streams), streamIndex(0), prefetchCount(0), prefetchBufferSize(0), prefetchEnd(0)
     {
     }
     ConcatInputStream(std::vector<std::shared_ptr<InputStream>> streams)
-        : streams(std::move(streams)), streamIndex(0)
+        : streams(std::move(streams)),
+          streamIndex(0),
+          prefetchCount(0),
+          prefetchBufferSize(0),
+          prefetchEnd(0)
     {
     }
-    virtual ReadBytesResult readBytes(unsigned char *buffer,
-                                      std::size_t bufferSize,
-                                      const std::chrono::steady_clock::time_point *timeout) override
+    /** reads the streams following the current one in the background, so opening and
+     * decompressing them overlaps with consuming the current one
+     */
+    ConcatInputStream(std::vector<std::shared_ptr<InputStream>> streams,
+                      PrefetchOptions prefetchOptions)
+        : streams(std::move(streams)),
+          streamIndex(0),
+          prefetchCount(prefetchOptions.streamCount),
+          prefetchBufferSize(0),
+          prefetchEnd(0)
+    {
+        if(prefetchCount > 0)
+        {
+            prefetchBufferSize =
+                prefetchOptions.memoryLimit / (prefetchCount * prefetchBuffersPerStream);
+            if(prefetchBufferSize < minimumPrefetchBufferSize)
+                prefetchBufferSize = minimumPrefetchBufferSize;
+        }
+        startPrefetching();
+    }
+
+private:
+    /** @return true if reading should stop early */
+    bool readInto(unsigned char *buffer,
+                  std::size_t bufferSize,
+                  const std::chrono::steady_clock::time_point *timeout,
+                  std::size_t &totalReadCount)
     {
-        std::size_t totalReadCount = 0;
         while(bufferSize > 0)
         {
             if(streamIndex >= streams.size())
-                return ReadBytesResult(totalReadCount, true);
+                return true;
             auto result = streams[streamIndex]->readBytes(buffer, bufferSize, timeout);
             constexprAssert(result.readCount <= bufferSize);
             totalReadCount += result.readCount;
             buffer += result.readCount;
             bufferSize -= result.readCount;
             if(result.hitEOF)
-                streamIndex++;
+                nextStream();
             else if(timeout)
+                return true;
+        }
+        return false;
+    }
+
+public:
+    virtual ReadBytesResult readBytes(unsigned char *buffer,
+                                      std::size_t bufferSize,
+                                      const std::chrono::steady_clock::time_point *timeout) override
+    {
+        std::size_t totalReadCount = 0;
+        readInto(buffer, bufferSize, timeout, totalReadCount);
+        return ReadBytesResult(totalReadCount, streamIndex >= streams.size());
+    }
+    virtual ReadBytesResult readBytesV(const ByteSpan *buffers,
+                                       std::size_t bufferCount,
+                                       const std::chrono::steady_clock::time_point *timeout) override
+    {
+        std::size_t totalReadCount = 0;
+        for(std::size_t i = 0; i < bufferCount; i++)
+        {
+            if(readInto(buffers[i].data, buffers[i].size, timeout, totalReadCount))
                 break;
         }
         return ReadBytesResult(totalReadCount, streamIndex >= streams.size());
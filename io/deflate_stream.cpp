@@ -0,0 +1,307 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#include "deflate_stream.h"
+#include <zlib.h>
+#include <new>
+#include <limits>
+#include "../util/constexpr_assert.h"
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace io
+{
+namespace
+{
+constexpr std::size_t deflateBufferSize = 0x10000;
+
+int getWindowBits(DeflateFormat format) noexcept
+{
+    switch(format)
+    {
+    case DeflateFormat::Raw:
+        return -MAX_WBITS;
+    case DeflateFormat::ZLib:
+        return MAX_WBITS;
+    case DeflateFormat::GZip:
+        return MAX_WBITS + 16;
+    }
+    constexprAssert(false);
+    return MAX_WBITS;
+}
+
+/** zlib counts in uInt, so big buffers are handled in pieces */
+uInt clampToUInt(std::size_t value) noexcept
+{
+    if(value > std::numeric_limits<uInt>::max())
+        return std::numeric_limits<uInt>::max();
+    return static_cast<uInt>(value);
+}
+
+IOError makeZLibError(const z_stream &stream, int result, const char *function)
+{
+    std::string message = function;
+    message += " failed";
+    if(stream.msg)
+    {
+        message += ": ";
+        message += stream.msg;
+    }
+    if(result == Z_MEM_ERROR)
+        return IOError(std::make_error_code(std::errc::not_enough_memory), message);
+    return IOError(std::make_error_code(std::errc::illegal_byte_sequence), message);
+}
+}
+
+struct DeflateInputStream::Implementation final
+{
+    std::shared_ptr<InputStream> stream;
+    z_stream zStream;
+    std::unique_ptr<unsigned char[]> inputBuffer;
+    bool streamHitEOF = false;
+    bool hitEndOfData = false;
+    Implementation(std::shared_ptr<InputStream> stream, DeflateFormat format)
+        : stream(std::move(stream)), zStream(), inputBuffer(new unsigned char[deflateBufferSize])
+    {
+        zStream.zalloc = Z_NULL;
+        zStream.zfree = Z_NULL;
+        zStream.opaque = Z_NULL;
+        zStream.next_in = Z_NULL;
+        zStream.avail_in = 0;
+        int result = inflateInit2(&zStream, getWindowBits(format));
+        if(result != Z_OK)
+        {
+            if(result == Z_MEM_ERROR)
+                throw std::bad_alloc();
+            throw makeZLibError(zStream, result, "inflateInit2");
+        }
+    }
+    ~Implementation()
+    {
+        inflateEnd(&zStream);
+    }
+    void reset(std::shared_ptr<InputStream> newStream)
+    {
+        stream = std::move(newStream);
+        inflateReset(&zStream);
+        zStream.next_in = Z_NULL;
+        zStream.avail_in = 0;
+        streamHitEOF = false;
+        hitEndOfData = false;
+    }
+    ReadBytesResult read(unsigned char *buffer,
+                         std::size_t bufferSize,
+                         const std::chrono::steady_clock::time_point *timeout)
+    {
+        std::size_t totalReadCount = 0;
+        while(totalReadCount == 0 && bufferSize > 0 && !hitEndOfData)
+        {
+            zStream.next_out = buffer;
+            zStream.avail_out = clampToUInt(bufferSize);
+            int result = inflate(&zStream, Z_NO_FLUSH);
+            totalReadCount += zStream.next_out - buffer;
+            if(result == Z_STREAM_END)
+                hitEndOfData = true;
+            else if(result == Z_BUF_ERROR ? zStream.avail_in != 0 : result != Z_OK)
+                throw makeZLibError(zStream, result, "inflate");
+            if(totalReadCount > 0 || hitEndOfData || zStream.avail_in != 0)
+                continue;
+            if(streamHitEOF)
+            {
+                // inflate can still hold output that didn't fit last time, so the data is only
+                // cut short once it reports that it can't make progress
+                if(result == Z_BUF_ERROR)
+                    throw EOFError();
+                continue;
+            }
+            auto readResult = stream->readBytes(inputBuffer.get(), deflateBufferSize, timeout);
+            streamHitEOF = readResult.hitEOF;
+            zStream.next_in = inputBuffer.get();
+            zStream.avail_in = static_cast<uInt>(readResult.readCount);
+            if(readResult.readCount == 0 && !readResult.hitEOF)
+                break; // timed out
+        }
+        return ReadBytesResult(totalReadCount, hitEndOfData);
+    }
+};
+
+DeflateInputStream::DeflateInputStream(std::shared_ptr<InputStream> stream, DeflateFormat format)
+    : implementation(new Implementation(std::move(stream), format))
+{
+}
+
+DeflateInputStream::~DeflateInputStream()
+{
+    delete implementation;
+}
+
+DeflateInputStream::ReadBytesResult DeflateInputStream::readBytes(
+    unsigned char *buffer,
+    std::size_t bufferSize,
+    const std::chrono::steady_clock::time_point *timeout)
+{
+    if(!implementation)
+        return ReadBytesResult(0, true);
+    return implementation->read(buffer, bufferSize, timeout);
+}
+
+void DeflateInputStream::reset(std::shared_ptr<InputStream> stream)
+{
+    constexprAssert(implementation);
+    implementation->reset(std::move(stream));
+}
+
+struct DeflateOutputStream::Implementation final
+{
+    std::shared_ptr<OutputStream> stream;
+    z_stream zStream;
+    std::unique_ptr<unsigned char[]> outputBuffer;
+    bool finished = false;
+    Implementation(std::shared_ptr<OutputStream> stream, int level, DeflateFormat format)
+        : stream(std::move(stream)), zStream(), outputBuffer(new unsigned char[deflateBufferSize])
+    {
+        zStream.zalloc = Z_NULL;
+        zStream.zfree = Z_NULL;
+        zStream.opaque = Z_NULL;
+        int result = deflateInit2(
+            &zStream, level, Z_DEFLATED, getWindowBits(format), 8, Z_DEFAULT_STRATEGY);
+        if(result != Z_OK)
+        {
+            if(result == Z_MEM_ERROR)
+                throw std::bad_alloc();
+            throw makeZLibError(zStream, result, "deflateInit2");
+        }
+    }
+    ~Implementation()
+    {
+        deflateEnd(&zStream);
+    }
+    /** runs deflate until all input is consumed and, for flushMode other than Z_NO_FLUSH, all
+     * output is written */
+    void run(int flushMode)
+    {
+        while(true)
+        {
+            zStream.next_out = outputBuffer.get();
+            zStream.avail_out = deflateBufferSize;
+            int result = deflate(&zStream, flushMode);
+            if(result == Z_STREAM_ERROR)
+                throw makeZLibError(zStream, result, "deflate");
+            std::size_t outputSize = deflateBufferSize - zStream.avail_out;
+            if(outputSize > 0)
+                stream->writeBytes(outputBuffer.get(), outputSize);
+            if(result == Z_STREAM_END)
+                return;
+            if(zStream.avail_out != 0 && zStream.avail_in == 0)
+                return;
+        }
+    }
+    void write(const unsigned char *buffer, std::size_t bufferSize)
+    {
+        constexprAssert(!finished);
+        while(bufferSize > 0)
+        {
+            uInt inputSize = clampToUInt(bufferSize);
+            zStream.next_in = const_cast<unsigned char *>(buffer);
+            zStream.avail_in = inputSize;
+            run(Z_NO_FLUSH);
+            buffer += inputSize;
+            bufferSize -= inputSize;
+        }
+    }
+    void flush()
+    {
+        if(!finished)
+        {
+            zStream.next_in = Z_NULL;
+            zStream.avail_in = 0;
+            run(Z_SYNC_FLUSH);
+        }
+        stream->flush();
+    }
+    void finish()
+    {
+        if(finished)
+            return;
+        finished = true;
+        zStream.next_in = Z_NULL;
+        zStream.avail_in = 0;
+        run(Z_FINISH);
+        stream->flush();
+    }
+    void reset(std::shared_ptr<OutputStream> newStream)
+    {
+        finish();
+        stream = std::move(newStream);
+        deflateReset(&zStream);
+        finished = false;
+    }
+};
+
+DeflateOutputStream::DeflateOutputStream(std::shared_ptr<OutputStream> stream,
+                                         int level,
+                                         DeflateFormat format)
+    : implementation(new Implementation(std::move(stream), level, format))
+{
+}
+
+DeflateOutputStream::~DeflateOutputStream()
+{
+    if(implementation)
+    {
+        try
+        {
+            implementation->finish();
+        }
+        catch(...)
+        {
+        }
+    }
+    delete implementation;
+}
+
+void DeflateOutputStream::writeBytes(const unsigned char *buffer, std::size_t bufferSize)
+{
+    constexprAssert(implementation);
+    implementation->write(buffer, bufferSize);
+}
+
+void DeflateOutputStream::flush()
+{
+    if(implementation)
+        implementation->flush();
+}
+
+void DeflateOutputStream::finish()
+{
+    if(implementation)
+        implementation->finish();
+}
+
+void DeflateOutputStream::reset(std::shared_ptr<OutputStream> stream)
+{
+    constexprAssert(implementation);
+    implementation->reset(std::move(stream));
+}
+}
+}
+}
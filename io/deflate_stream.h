@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#ifndef IO_DEFLATE_STREAM_H_
+#define IO_DEFLATE_STREAM_H_
+
+#include "input_stream.h"
+#include "output_stream.h"
+#include <memory>
+#include <utility>
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace io
+{
+enum class DeflateFormat
+{
+    Raw,
+    ZLib,
+    GZip,
+};
+
+/** decompresses a deflate stream read from another stream. Any bytes the underlying stream holds
+ * after the end of the compressed data may have been read and are discarded.
+ */
+class DeflateInputStream final : public InputStream
+{
+private:
+    struct Implementation;
+
+private:
+    Implementation *implementation;
+
+public:
+    explicit DeflateInputStream(std::shared_ptr<InputStream> stream,
+                                DeflateFormat format = DeflateFormat::ZLib);
+    virtual ~DeflateInputStream();
+    DeflateInputStream(DeflateInputStream &&rt) noexcept : InputStream(std::move(rt)),
+                                                           implementation(rt.implementation)
+    {
+        rt.implementation = nullptr;
+    }
+    DeflateInputStream &operator=(DeflateInputStream rt) noexcept
+    {
+        InputStream::operator=(std::move(rt));
+        std::swap(implementation, rt.implementation);
+        return *this;
+    }
+    virtual ReadBytesResult readBytes(
+        unsigned char *buffer,
+        std::size_t bufferSize,
+        const std::chrono::steady_clock::time_point *timeout) override;
+    /** starts decompressing stream, reusing the codec state and buffers */
+    void reset(std::shared_ptr<InputStream> stream);
+};
+
+/** compresses everything written to it into another stream */
+class DeflateOutputStream final : public OutputStream
+{
+public:
+    static constexpr int defaultLevel = -1;
+    static constexpr int fastestLevel = 1;
+    static constexpr int bestLevel = 9;
+
+private:
+    struct Implementation;
+
+private:
+    Implementation *implementation;
+
+public:
+    /** @param level 0 to 9 or defaultLevel */
+    explicit DeflateOutputStream(std::shared_ptr<OutputStream> stream,
+                                 int level = defaultLevel,
+                                 DeflateFormat format = DeflateFormat::ZLib);
+    /** calls finish, ignoring any errors */
+    virtual ~DeflateOutputStream();
+    DeflateOutputStream(DeflateOutputStream &&rt) noexcept : OutputStream(std::move(rt)),
+                                                             implementation(rt.implementation)
+    {
+        rt.implementation = nullptr;
+    }
+    DeflateOutputStream &operator=(DeflateOutputStream rt) noexcept
+    {
+        OutputStream::operator=(std::move(rt));
+        std::swap(implementation, rt.implementation);
+        return *this;
+    }
+    virtual void writeBytes(const unsigned char *buffer, std::size_t bufferSize) override;
+    /** writes out everything compressed so far, at some cost in compression ratio */
+    virtual void flush() override;
+    /** ends the compressed data and flushes the underlying stream */
+    void finish();
+    /** finishes the current stream, then starts compressing into stream, reusing the codec state
+     * and buffers */
+    void reset(std::shared_ptr<OutputStream> stream);
+};
+}
+}
+}
+
+#endif /* IO_DEFLATE_STREAM_H_ */
@@ -0,0 +1,357 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#include "descriptor_reactor.h"
+#ifndef _WIN32
+#include "stream_base.h"
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#ifdef __linux
+#include <sys/epoll.h>
+#endif
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace io
+{
+struct DescriptorReactor::Implementation final
+{
+    struct Waiter final
+    {
+        short events;
+        WaitCallback callback;
+        Waiter(short events, WaitCallback callback) : events(events), callback(std::move(callback))
+        {
+        }
+    };
+    std::mutex lock;
+    std::unordered_map<int, std::vector<Waiter>> waiters;
+    bool done = false;
+    /** written to wake the thread up */
+    int wakeWriteFD = -1;
+    int wakeReadFD = -1;
+#ifdef __linux
+    int epollFD = -1;
+    std::unordered_map<int, short> registeredEvents;
+#endif
+    std::thread thread;
+    Implementation()
+    {
+        int fds[2];
+        if(::pipe(fds) != 0)
+        {
+            int error = errno;
+            throw IOError(error, std::generic_category(), "pipe failed");
+        }
+        wakeReadFD = fds[0];
+        wakeWriteFD = fds[1];
+        for(int fd : fds)
+        {
+            ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+            ::fcntl(fd, F_SETFD, ::fcntl(fd, F_GETFD) | FD_CLOEXEC);
+        }
+#ifdef __linux
+        epollFD = ::epoll_create1(EPOLL_CLOEXEC);
+        ::epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = wakeReadFD;
+        if(epollFD < 0 || ::epoll_ctl(epollFD, EPOLL_CTL_ADD, wakeReadFD, &event) != 0)
+        {
+            int error = errno;
+            closeDescriptors();
+            throw IOError(error, std::generic_category(), "epoll setup failed");
+        }
+#endif
+        try
+        {
+            thread = std::thread(&Implementation::threadFunction, this);
+        }
+        catch(...)
+        {
+            closeDescriptors();
+            throw;
+        }
+    }
+    ~Implementation()
+    {
+        std::unique_lock<std::mutex> lockIt(lock);
+        done = true;
+        wake();
+        lockIt.unlock();
+        thread.join();
+        closeDescriptors();
+    }
+    void closeDescriptors() noexcept
+    {
+        ::close(wakeReadFD);
+        ::close(wakeWriteFD);
+#ifdef __linux
+        if(epollFD >= 0)
+            ::close(epollFD);
+#endif
+    }
+    void wake() noexcept
+    {
+        unsigned char byte = 0;
+        // a full pipe already wakes the thread, so failing to write is fine
+        while(::write(wakeWriteFD, &byte, 1) < 0 && errno == EINTR)
+        {
+        }
+    }
+    void drainWakeups() noexcept
+    {
+        unsigned char buffer[64];
+        while(::read(wakeReadFD, buffer, sizeof(buffer)) > 0 || errno == EINTR)
+        {
+        }
+    }
+    short getWantedEvents(int fd) const
+    {
+        short retval = 0;
+        auto iter = waiters.find(fd);
+        if(iter != waiters.end())
+            for(const Waiter &waiter : iter->second)
+                retval |= waiter.events;
+        return retval;
+    }
+#ifdef __linux
+    /** makes fd's epoll registration match its waiters
+     * @return false if fd can't be used with epoll */
+    bool updateRegistration(int fd)
+    {
+        short events = getWantedEvents(fd);
+        auto iter = registeredEvents.find(fd);
+        if(events == 0)
+        {
+            if(iter != registeredEvents.end())
+            {
+                ::epoll_ctl(epollFD, EPOLL_CTL_DEL, fd, nullptr);
+                registeredEvents.erase(iter);
+            }
+            return true;
+        }
+        if(iter != registeredEvents.end() && iter->second == events)
+            return true;
+        ::epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        if(events & POLLIN)
+            event.events |= EPOLLIN;
+        if(events & POLLOUT)
+            event.events |= EPOLLOUT;
+        event.data.fd = fd;
+        int operation = iter != registeredEvents.end() ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+        if(::epoll_ctl(epollFD, operation, fd, &event) != 0)
+        {
+            // the descriptor was closed and its number reused behind our back
+            if(errno == ENOENT || errno == EEXIST)
+                operation = operation == EPOLL_CTL_MOD ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+            if(::epoll_ctl(epollFD, operation, fd, &event) != 0)
+                return false;
+        }
+        registeredEvents[fd] = events;
+        return true;
+    }
+#endif
+    /** moves the callbacks of the waits on fd that revents satisfies into ready */
+    void dispatch(int fd, short revents, std::vector<WaitCallback> &ready)
+    {
+        auto iter = waiters.find(fd);
+        if(iter == waiters.end())
+            return;
+        if(revents & (POLLERR | POLLHUP | POLLNVAL))
+            revents |= POLLIN | POLLOUT;
+        std::vector<Waiter> &fdWaiters = iter->second;
+        for(std::size_t i = 0; i < fdWaiters.size();)
+        {
+            if(fdWaiters[i].events & revents)
+            {
+                ready.push_back(std::move(fdWaiters[i].callback));
+                fdWaiters.erase(fdWaiters.begin() + i);
+            }
+            else
+            {
+                i++;
+            }
+        }
+        if(fdWaiters.empty())
+            waiters.erase(iter);
+#ifdef __linux
+        updateRegistration(fd);
+#endif
+    }
+    void threadFunction()
+    {
+        std::unique_lock<std::mutex> lockIt(lock);
+        std::vector<WaitCallback> ready;
+#ifdef __linux
+        constexpr int maxEventCount = 64;
+        ::epoll_event events[maxEventCount];
+#else
+        std::vector<::pollfd> pollFDs;
+#endif
+        while(!done)
+        {
+#ifdef __linux
+            lockIt.unlock();
+            int eventCount = ::epoll_wait(epollFD, events, maxEventCount, -1);
+            int error = errno;
+            lockIt.lock();
+#else
+            pollFDs.clear();
+            ::pollfd pollFD;
+            pollFD.fd = wakeReadFD;
+            pollFD.events = POLLIN;
+            pollFD.revents = 0;
+            pollFDs.push_back(pollFD);
+            for(auto &entry : waiters)
+            {
+                pollFD.fd = entry.first;
+                pollFD.events = getWantedEvents(entry.first);
+                pollFDs.push_back(pollFD);
+            }
+            lockIt.unlock();
+            int eventCount = ::poll(pollFDs.data(), pollFDs.size(), -1);
+            int error = errno;
+            lockIt.lock();
+#endif
+            if(eventCount < 0)
+            {
+                if(error == EINTR)
+                    continue;
+                std::cerr << "DescriptorReactor: waiting failed: " << std::strerror(error)
+                          << std::endl;
+                std::abort();
+            }
+#ifdef __linux
+            for(int i = 0; i < eventCount; i++)
+            {
+                short revents = 0;
+                if(events[i].events & EPOLLIN)
+                    revents |= POLLIN;
+                if(events[i].events & EPOLLOUT)
+                    revents |= POLLOUT;
+                if(events[i].events & (EPOLLERR | EPOLLHUP))
+                    revents |= POLLERR;
+                if(events[i].data.fd == wakeReadFD)
+                    drainWakeups();
+                else
+                    dispatch(events[i].data.fd, revents, ready);
+            }
+#else
+            for(const ::pollfd &pollFD : pollFDs)
+            {
+                if(pollFD.revents == 0)
+                    continue;
+                if(pollFD.fd == wakeReadFD)
+                    drainWakeups();
+                else
+                    dispatch(pollFD.fd, pollFD.revents, ready);
+            }
+#endif
+            if(ready.empty())
+                continue;
+            lockIt.unlock();
+            for(WaitCallback &callback : ready)
+                callback(true);
+            ready.clear();
+            lockIt.lock();
+        }
+    }
+};
+
+DescriptorReactor::DescriptorReactor() : implementation(new Implementation)
+{
+}
+
+DescriptorReactor::~DescriptorReactor()
+{
+    delete implementation;
+}
+
+void DescriptorReactor::wait(int fd, short events, WaitCallback callback)
+{
+    std::unique_lock<std::mutex> lockIt(implementation->lock);
+    std::vector<Implementation::Waiter> &fdWaiters = implementation->waiters[fd];
+    fdWaiters.emplace_back(events, std::move(callback));
+#ifdef __linux
+    if(!implementation->updateRegistration(fd))
+    {
+        int error = errno;
+        fdWaiters.pop_back();
+        if(fdWaiters.empty())
+            implementation->waiters.erase(fd);
+        throw IOError(error, std::generic_category(), "epoll_ctl failed");
+    }
+#else
+    implementation->wake(); // so poll picks up the new descriptor
+#endif
+}
+
+void DescriptorReactor::cancel(int fd, short events)
+{
+    std::vector<WaitCallback> canceled;
+    std::unique_lock<std::mutex> lockIt(implementation->lock);
+    auto iter = implementation->waiters.find(fd);
+    if(iter == implementation->waiters.end())
+        return;
+    std::vector<Implementation::Waiter> &fdWaiters = iter->second;
+    for(std::size_t i = 0; i < fdWaiters.size();)
+    {
+        if(fdWaiters[i].events & events)
+        {
+            canceled.push_back(std::move(fdWaiters[i].callback));
+            fdWaiters.erase(fdWaiters.begin() + i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+    if(fdWaiters.empty())
+        implementation->waiters.erase(iter);
+#ifdef __linux
+    implementation->updateRegistration(fd);
+#endif
+    lockIt.unlock();
+    for(WaitCallback &callback : canceled)
+        callback(false);
+}
+
+DescriptorReactor &DescriptorReactor::getShared()
+{
+    static DescriptorReactor retval;
+    return retval;
+}
+}
+}
+}
+#endif
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#ifndef IO_DESCRIPTOR_REACTOR_H_
+#define IO_DESCRIPTOR_REACTOR_H_
+
+#include <functional>
+
+#ifndef _WIN32
+namespace programmerjake
+{
+namespace voxels
+{
+namespace io
+{
+/** waits for many descriptors on one shared thread, using epoll on Linux and poll elsewhere, so
+ * thousands of idle streams don't each hold a thread
+ */
+class DescriptorReactor final
+{
+    DescriptorReactor(const DescriptorReactor &) = delete;
+    DescriptorReactor &operator=(const DescriptorReactor &) = delete;
+
+public:
+    /** called with true once the descriptor is ready, or false if the wait was canceled */
+    typedef std::function<void(bool ready)> WaitCallback;
+
+private:
+    struct Implementation;
+
+private:
+    Implementation *implementation;
+
+public:
+    DescriptorReactor();
+    /** stops the thread; callbacks for waits still pending are destroyed without being called */
+    ~DescriptorReactor();
+    /** calls callback on the reactor thread once fd is ready for events. Errors and hangups count
+     * as ready, so the caller finds out about them from its next read or write. Callbacks must
+     * not block; they may start new waits.
+     * @param events POLLIN and/or POLLOUT
+     */
+    void wait(int fd, short events, WaitCallback callback);
+    /** removes the waits on fd for any of events, then calls their callbacks with false on this
+     * thread. Call this before closing fd. */
+    void cancel(int fd, short events);
+    static DescriptorReactor &getShared();
+};
+}
+}
+}
+#endif
+
+#endif /* IO_DESCRIPTOR_REACTOR_H_ */
@@ -0,0 +1,435 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#include "descriptor_stream.h"
+#ifndef _WIN32
+#include <cstring>
+#include <climits>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <mutex>
+#include "descriptor_reactor.h"
+#include "../util/constexpr_assert.h"
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace io
+{
+namespace
+{
+#ifdef MSG_NOSIGNAL
+constexpr int sendFlags = MSG_NOSIGNAL;
+#else
+constexpr int sendFlags = 0;
+#endif
+
+void closeNoThrow(int fd) noexcept
+{
+    if(fd >= 0)
+        ::close(fd);
+}
+
+/** reads whatever is available without waiting
+ * @return false if nothing was available yet */
+bool tryRead(int fd,
+             unsigned char *buffer,
+             std::size_t bufferSize,
+             InputStream::ReadBytesResult &result)
+{
+    std::size_t totalReadCount = 0;
+    while(totalReadCount < bufferSize)
+    {
+        auto readCount = ::read(fd, buffer + totalReadCount, bufferSize - totalReadCount);
+        if(readCount > 0)
+        {
+            totalReadCount += readCount;
+            continue;
+        }
+        if(readCount == 0)
+        {
+            result = InputStream::ReadBytesResult(totalReadCount, true);
+            return true;
+        }
+        if(errno == EINTR)
+            continue;
+        if(errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            int error = errno;
+            throw IOError(error, std::generic_category(), "read failed");
+        }
+        break;
+    }
+    result = InputStream::ReadBytesResult(totalReadCount, false);
+    return totalReadCount > 0 || bufferSize == 0;
+}
+}
+
+struct DescriptorStream::AsyncReadState final
+    : public std::enable_shared_from_this<AsyncReadState>
+{
+    std::mutex lock;
+    /** set to -1, with lock held, before the descriptor is closed */
+    int fd;
+    bool readPending = false;
+    explicit AsyncReadState(int fd) : fd(fd)
+    {
+    }
+    /** reads what's available, or waits on the reactor if nothing is. Holding lock while using
+     * fd and starting the wait keeps closeDescriptor from closing fd in between. */
+    void continueRead(std::unique_lock<std::mutex> &lockIt,
+                      unsigned char *buffer,
+                      std::size_t bufferSize,
+                      ReadBytesCallback callback)
+    {
+        ReadBytesResult result(0, false);
+        std::exception_ptr error;
+        try
+        {
+            if(fd < 0)
+                throw IOError(std::make_error_code(std::errc::operation_canceled), "read canceled");
+            if(!tryRead(fd, buffer, bufferSize, result))
+            {
+                auto self = shared_from_this();
+                // runs on the reactor thread, which mustn't block, so only retry the
+                // non-blocking read
+                DescriptorReactor::getShared().wait(
+                    fd,
+                    POLLIN,
+                    [self, buffer, bufferSize, callback](bool ready)
+                    {
+                        std::unique_lock<std::mutex> lockIt(self->lock);
+                        if(ready)
+                        {
+                            self->continueRead(lockIt, buffer, bufferSize, callback);
+                            return;
+                        }
+                        self->finishRead(lockIt,
+                                         ReadBytesResult(0, false),
+                                         std::make_exception_ptr(IOError(
+                                             std::make_error_code(std::errc::operation_canceled),
+                                             "read canceled")),
+                                         callback);
+                    });
+                return;
+            }
+        }
+        catch(...)
+        {
+            error = std::current_exception();
+        }
+        finishRead(lockIt, result, error, callback);
+    }
+    void finishRead(std::unique_lock<std::mutex> &lockIt,
+                    ReadBytesResult result,
+                    std::exception_ptr error,
+                    const ReadBytesCallback &callback)
+    {
+        readPending = false;
+        lockIt.unlock();
+        callback(result, error);
+    }
+};
+
+DescriptorStream::DescriptorStream(int fd) : fd(fd), isSocket(false)
+{
+    constexprAssert(fd >= 0);
+    struct ::stat fileStatus;
+    if(::fstat(fd, &fileStatus) != 0)
+    {
+        int error = errno;
+        closeNoThrow(fd);
+        throw IOError(error, std::generic_category(), "fstat failed");
+    }
+    isSocket = S_ISSOCK(fileStatus.st_mode);
+    int flags = ::fcntl(fd, F_GETFL);
+    if(flags < 0 || ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+    {
+        int error = errno;
+        closeNoThrow(fd);
+        throw IOError(error, std::generic_category(), "fcntl failed");
+    }
+    ::fcntl(fd, F_SETFD, ::fcntl(fd, F_GETFD) | FD_CLOEXEC);
+}
+
+DescriptorStream::~DescriptorStream()
+{
+    if(fd >= 0)
+        closeDescriptor();
+}
+
+bool DescriptorStream::isReadPending() const noexcept
+{
+    if(!asyncReadState)
+        return false;
+    std::unique_lock<std::mutex> lockIt(asyncReadState->lock);
+    return asyncReadState->readPending;
+}
+
+int DescriptorStream::closeDescriptor() noexcept
+{
+    if(asyncReadState)
+    {
+        std::unique_lock<std::mutex> lockIt(asyncReadState->lock);
+        // a reactor callback that already started is done with fd once we have the lock, and
+        // later ones see it's closed
+        asyncReadState->fd = -1;
+        bool readPending = asyncReadState->readPending;
+        lockIt.unlock();
+        if(readPending)
+            DescriptorReactor::getShared().cancel(fd, POLLIN);
+    }
+    int result = ::close(fd);
+    fd = -1;
+    return result;
+}
+
+std::pair<std::shared_ptr<DescriptorStream>, std::shared_ptr<DescriptorStream>>
+    DescriptorStream::createPipe()
+{
+    int fds[2];
+    if(::pipe(fds) != 0)
+    {
+        int error = errno;
+        throw IOError(error, std::generic_category(), "pipe failed");
+    }
+    std::shared_ptr<DescriptorStream> readEnd;
+    try
+    {
+        readEnd = std::make_shared<DescriptorStream>(fds[0]);
+    }
+    catch(...)
+    {
+        closeNoThrow(fds[1]);
+        throw;
+    }
+    return std::make_pair(std::move(readEnd), std::make_shared<DescriptorStream>(fds[1]));
+}
+
+std::pair<std::shared_ptr<DescriptorStream>, std::shared_ptr<DescriptorStream>>
+    DescriptorStream::createSocketPair()
+{
+    int fds[2];
+    if(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+    {
+        int error = errno;
+        throw IOError(error, std::generic_category(), "socketpair failed");
+    }
+    std::shared_ptr<DescriptorStream> first;
+    try
+    {
+        first = std::make_shared<DescriptorStream>(fds[0]);
+    }
+    catch(...)
+    {
+        closeNoThrow(fds[1]);
+        throw;
+    }
+    return std::make_pair(std::move(first), std::make_shared<DescriptorStream>(fds[1]));
+}
+
+std::shared_ptr<DescriptorStream> DescriptorStream::connectUnixSocket(const std::string &path)
+{
+    ::sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(path.size() >= sizeof(address.sun_path))
+        throw IOError(std::make_error_code(std::errc::filename_too_long),
+                      "socket path too long: " + path);
+    std::memcpy(address.sun_path, path.data(), path.size());
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0)
+    {
+        int error = errno;
+        throw IOError(error, std::generic_category(), "socket failed");
+    }
+    int result;
+    do
+    {
+        result = ::connect(fd, reinterpret_cast<const ::sockaddr *>(&address), sizeof(address));
+    } while(result != 0 && errno == EINTR);
+    if(result != 0)
+    {
+        int error = errno;
+        closeNoThrow(fd);
+        throw IOError(error, std::generic_category(), "connect failed: " + path);
+    }
+    return std::make_shared<DescriptorStream>(fd);
+}
+
+bool DescriptorStream::waitFor(short events, const std::chrono::steady_clock::time_point *timeout)
+{
+    while(true)
+    {
+        int timeoutMilliseconds = -1;
+        if(timeout)
+        {
+            auto now = std::chrono::steady_clock::now();
+            if(*timeout <= now)
+            {
+                timeoutMilliseconds = 0;
+            }
+            else
+            {
+                auto remaining = *timeout - now;
+                auto milliseconds =
+                    std::chrono::duration_cast<std::chrono::milliseconds>(remaining).count();
+                if(remaining > std::chrono::milliseconds(milliseconds))
+                    milliseconds++; // round up so we don't wake up early
+                timeoutMilliseconds = milliseconds > INT_MAX ? INT_MAX :
+                                                               static_cast<int>(milliseconds);
+            }
+        }
+        ::pollfd pollFD;
+        pollFD.fd = fd;
+        pollFD.events = events;
+        pollFD.revents = 0;
+        int result = ::poll(&pollFD, 1, timeoutMilliseconds);
+        if(result < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            int error = errno;
+            throw IOError(error, std::generic_category(), "poll failed");
+        }
+        if(result > 0)
+            return true;
+        if(timeoutMilliseconds == 0)
+            return false;
+        if(timeout && *timeout <= std::chrono::steady_clock::now())
+            return false;
+    }
+}
+
+DescriptorStream::ReadBytesResult DescriptorStream::readBytes(
+    unsigned char *buffer,
+    std::size_t bufferSize,
+    const std::chrono::steady_clock::time_point *timeout)
+{
+    if(fd < 0)
+        return ReadBytesResult(0, true);
+    ReadBytesResult result(0, false);
+    while(!tryRead(fd, buffer, bufferSize, result))
+    {
+        if(!waitFor(POLLIN, timeout))
+            break;
+    }
+    return result;
+}
+
+void DescriptorStream::readBytesWhenReady(unsigned char *buffer,
+                                          std::size_t bufferSize,
+                                          ReadBytesCallback callback)
+{
+    if(fd < 0)
+    {
+        callback(ReadBytesResult(0, true), std::exception_ptr());
+        return;
+    }
+    if(!asyncReadState)
+        asyncReadState = std::make_shared<AsyncReadState>(fd);
+    std::unique_lock<std::mutex> lockIt(asyncReadState->lock);
+    constexprAssert(!asyncReadState->readPending);
+    asyncReadState->readPending = true;
+    asyncReadState->continueRead(lockIt, buffer, bufferSize, std::move(callback));
+}
+
+void DescriptorStream::readBytesAsync(unsigned char *buffer,
+                                      std::size_t bufferSize,
+                                      util::Executor &executor,
+                                      ReadBytesCallback callback)
+{
+    util::Executor *executorPointer = &executor;
+    readBytesWhenReady(buffer,
+                       bufferSize,
+                       [executorPointer, callback](ReadBytesResult result, std::exception_ptr error)
+                       {
+                           executorPointer->execute([callback, result, error]()
+                                                    {
+                                                        callback(result, error);
+                                                    });
+                       });
+}
+
+void DescriptorStream::cancelReadBytesAsync()
+{
+    if(fd < 0 || !isReadPending())
+        return;
+    // the reactor calls the canceled callback on this thread, and it takes asyncReadState->lock
+    DescriptorReactor::getShared().cancel(fd, POLLIN);
+}
+
+void DescriptorStream::writeBytes(const unsigned char *buffer, std::size_t bufferSize)
+{
+    constexprAssert(fd >= 0);
+    while(bufferSize > 0)
+    {
+        auto result = isSocket ? ::send(fd, buffer, bufferSize, sendFlags) :
+                                 ::write(fd, buffer, bufferSize);
+        if(result >= 0)
+        {
+            buffer += result;
+            bufferSize -= result;
+            continue;
+        }
+        if(errno == EINTR)
+            continue;
+        if(errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            int error = errno;
+            throw IOError(error, std::generic_category(), "write failed");
+        }
+        waitFor(POLLOUT, nullptr);
+    }
+}
+
+void DescriptorStream::flush()
+{
+}
+
+void DescriptorStream::shutdownWrite()
+{
+    if(fd < 0 || !isSocket)
+        return;
+    if(::shutdown(fd, SHUT_WR) != 0)
+    {
+        int error = errno;
+        throw IOError(error, std::generic_category(), "shutdown failed");
+    }
+}
+
+void DescriptorStream::close()
+{
+    if(fd < 0)
+        return;
+    int result = closeDescriptor();
+    if(result != 0 && errno != EINTR)
+        throw IOError(errno, std::generic_category(), "close failed");
+}
+}
+}
+}
+#endif
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#ifndef IO_DESCRIPTOR_STREAM_H_
+#define IO_DESCRIPTOR_STREAM_H_
+
+#include "input_output_stream.h"
+#include "../util/constexpr_assert.h"
+#include <memory>
+#include <string>
+#include <utility>
+
+#ifndef _WIN32
+namespace programmerjake
+{
+namespace voxels
+{
+namespace io
+{
+/** a stream over a pipe or socket file descriptor, switched to non-blocking mode so readBytes
+ * can honor its timeout and return partial reads as soon as data arrives. readBytes waits on the
+ * calling thread; readBytesWhenReady and readBytesAsync wait on the shared DescriptorReactor
+ * instead, so many streams can be read without a thread each.
+ */
+class DescriptorStream final : public InputOutputStream
+{
+private:
+    struct AsyncReadState;
+
+private:
+    int fd;
+    bool isSocket;
+    /** shared with the reactor's callback, which must not touch fd once it's closed */
+    std::shared_ptr<AsyncReadState> asyncReadState;
+
+private:
+    /** @return true if fd is ready, false if timeout was reached */
+    bool waitFor(short events, const std::chrono::steady_clock::time_point *timeout);
+    bool isReadPending() const noexcept;
+    /** stops the reactor from using fd, cancels a pending read, then closes fd */
+    int closeDescriptor() noexcept;
+
+public:
+    /** takes ownership of fd */
+    explicit DescriptorStream(int fd);
+    virtual ~DescriptorStream();
+    /** rt must not have a read pending */
+    DescriptorStream(DescriptorStream &&rt) noexcept
+        : InputOutputStream(std::move(rt)),
+          fd(rt.fd),
+          isSocket(rt.isSocket),
+          asyncReadState(std::move(rt.asyncReadState))
+    {
+        constexprAssert(!isReadPending());
+        rt.fd = -1;
+    }
+    DescriptorStream &operator=(DescriptorStream rt) noexcept
+    {
+        InputOutputStream::operator=(std::move(rt));
+        std::swap(fd, rt.fd);
+        std::swap(isSocket, rt.isSocket);
+        std::swap(asyncReadState, rt.asyncReadState);
+        return *this;
+    }
+    /** @return the read end and the write end of a new pipe. Like any pipe, writing after the
+     * read end is closed raises SIGPIPE unless it's ignored. */
+    static std::pair<std::shared_ptr<DescriptorStream>, std::shared_ptr<DescriptorStream>>
+        createPipe();
+    /** @return both ends of a new connected Unix-domain stream socket pair */
+    static std::pair<std::shared_ptr<DescriptorStream>, std::shared_ptr<DescriptorStream>>
+        createSocketPair();
+    static std::shared_ptr<DescriptorStream> connectUnixSocket(const std::string &path);
+    /** blocks until at least one byte is read, the end of the stream is reached, or timeout is
+     * reached, then returns whatever is available without waiting further */
+    virtual ReadBytesResult readBytes(
+        unsigned char *buffer,
+        std::size_t bufferSize,
+        const std::chrono::steady_clock::time_point *timeout) override;
+    /** tries to read straight away; if nothing is available, waits on
+     * DescriptorReactor::getShared() instead of a thread. callback runs on the calling thread if
+     * the read finishes straight away and on the reactor thread otherwise, so it must not block.
+     * buffer must stay valid until callback is called, and only one read may be pending at a
+     * time. Closing or destroying this stream completes a pending read on the closing thread,
+     * with an operation_canceled IOError.
+     */
+    void readBytesWhenReady(unsigned char *buffer,
+                            std::size_t bufferSize,
+                            ReadBytesCallback callback);
+    /** like readBytesWhenReady, but callback is run on executor, so it may block */
+    virtual void readBytesAsync(unsigned char *buffer,
+                                std::size_t bufferSize,
+                                util::Executor &executor,
+                                ReadBytesCallback callback) override;
+    /** cancels a read waiting on the reactor; its callback gets an operation_canceled IOError */
+    virtual void cancelReadBytesAsync() override;
+    virtual void writeBytes(const unsigned char *buffer, std::size_t bufferSize) override;
+    virtual void flush() override;
+    /** shuts down the sending side of a socket so the peer reads the end of the stream */
+    void shutdownWrite();
+    void close();
+};
+}
+}
+}
+#endif
+
+#endif /* IO_DESCRIPTOR_STREAM_H_ */
@@ -21,8 +21,18 @@
 #include "file_stream.h"
 #include <cstdio>
 #include "../util/text.h"
+#include <cstring>
+#include <memory>
+#include "../util/constexpr_assert.h"
 #ifdef _WIN32
 #include <wchar.h>
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
 #endif
 
 namespace programmerjake
@@ -31,12 +41,420 @@ namespace voxels
 {
 namespace io
 {
+#ifdef __linux
+namespace
+{
+constexpr std::size_t fileBufferSize = 0x10000;
+
+int openFile(const std::string &fileName, int flags)
+{
+    int fd;
+    do
+    {
+        fd = ::open(fileName.c_str(), flags | O_CLOEXEC, 0666);
+    } while(fd < 0 && errno == EINTR);
+    if(fd < 0)
+    {
+        int error = errno;
+        throw IOError(error, std::generic_category(), "open failed: " + fileName);
+    }
+    return fd;
+}
+
+/** reads until bufferSize bytes are read or the end of the file is reached
+ * @return the number of bytes read
+ */
+std::size_t readFully(int fd, unsigned char *buffer, std::size_t bufferSize)
+{
+    std::size_t retval = 0;
+    while(retval < bufferSize)
+    {
+        auto result = ::read(fd, buffer + retval, bufferSize - retval);
+        if(result < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            int error = errno;
+            throw IOError(error, std::generic_category(), "read failed");
+        }
+        if(result == 0)
+            break;
+        retval += result;
+    }
+    return retval;
+}
+
+constexpr std::size_t maxIOVecCount = 64;
+
+/** fills iovecs from the spans starting at spans[index], skipping offset bytes
+ * @return the number of iovecs filled
+ */
+template <typename Span>
+std::size_t fillIOVecs(::iovec *iovecs,
+                       const Span *spans,
+                       std::size_t spanCount,
+                       std::size_t index,
+                       std::size_t offset)
+{
+    std::size_t retval = 0;
+    for(; index < spanCount && retval < maxIOVecCount; index++, offset = 0)
+    {
+        if(spans[index].size == offset)
+            continue;
+        iovecs[retval].iov_base = const_cast<unsigned char *>(spans[index].data + offset);
+        iovecs[retval].iov_len = spans[index].size - offset;
+        retval++;
+    }
+    return retval;
+}
+
+/** advances index and offset past count bytes of spans */
+template <typename Span>
+void advanceSpans(const Span *spans,
+                  std::size_t spanCount,
+                  std::size_t &index,
+                  std::size_t &offset,
+                  std::size_t count)
+{
+    while(index < spanCount)
+    {
+        std::size_t available = spans[index].size - offset;
+        if(count < available)
+        {
+            offset += count;
+            return;
+        }
+        count -= available;
+        index++;
+        offset = 0;
+    }
+}
+
+void writeFully(int fd, const unsigned char *buffer, std::size_t bufferSize)
+{
+    while(bufferSize > 0)
+    {
+        auto result = ::write(fd, buffer, bufferSize);
+        if(result < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            int error = errno;
+            throw IOError(error, std::generic_category(), "write failed");
+        }
+        buffer += result;
+        bufferSize -= result;
+    }
+}
+}
+
+struct FileInputStream::Implementation final
+{
+    int fd;
+    std::unique_ptr<unsigned char[]> buffer;
+    std::size_t bufferStart = 0;
+    std::size_t bufferEnd = 0;
+    bool hitEOF = false;
+    explicit Implementation(int fd) : fd(fd), buffer(new unsigned char[fileBufferSize])
+    {
+    }
+    ReadBytesResult read(unsigned char *readBuffer, std::size_t readBufferSize)
+    {
+        if(fd < 0)
+            return ReadBytesResult(0, true);
+        std::size_t readCount = bufferEnd - bufferStart;
+        if(readCount > readBufferSize)
+            readCount = readBufferSize;
+        if(readCount > 0)
+            std::memcpy(readBuffer, buffer.get() + bufferStart, readCount);
+        bufferStart += readCount;
+        readBuffer += readCount;
+        readBufferSize -= readCount;
+        if(readBufferSize == 0 || hitEOF)
+            return ReadBytesResult(readCount, hitEOF && bufferStart == bufferEnd);
+        // the buffer is empty here: big reads go straight to the caller's buffer
+        if(readBufferSize >= fileBufferSize)
+        {
+            bufferStart = 0;
+            bufferEnd = 0;
+            std::size_t directReadCount = readFully(fd, readBuffer, readBufferSize);
+            hitEOF = directReadCount < readBufferSize;
+            return ReadBytesResult(readCount + directReadCount, hitEOF);
+        }
+        bufferStart = 0;
+        bufferEnd = 0;
+        while(bufferEnd < readBufferSize && !hitEOF)
+        {
+            auto result = ::read(fd, buffer.get() + bufferEnd, fileBufferSize - bufferEnd);
+            if(result < 0)
+            {
+                if(errno == EINTR)
+                    continue;
+                int error = errno;
+                throw IOError(error, std::generic_category(), "read failed");
+            }
+            if(result == 0)
+                hitEOF = true;
+            bufferEnd += result;
+        }
+        std::size_t copyCount = bufferEnd < readBufferSize ? bufferEnd : readBufferSize;
+        std::memcpy(readBuffer, buffer.get(), copyCount);
+        bufferStart = copyCount;
+        return ReadBytesResult(readCount + copyCount, hitEOF && bufferStart == bufferEnd);
+    }
+    ReadBytesResult readV(const ByteSpan *spans, std::size_t spanCount)
+    {
+        if(fd < 0)
+            return ReadBytesResult(0, true);
+        std::size_t totalReadCount = 0;
+        std::size_t remainingSize = 0;
+        for(std::size_t i = 0; i < spanCount; i++)
+            remainingSize += spans[i].size;
+        std::size_t index = 0;
+        std::size_t offset = 0;
+        while(index < spanCount)
+        {
+            // once the buffer is drained, big requests go straight to the caller's buffers
+            if(bufferStart == bufferEnd && !hitEOF && remainingSize >= fileBufferSize)
+                return readVDirect(spans, spanCount, index, offset, totalReadCount);
+            auto result = read(spans[index].data + offset, spans[index].size - offset);
+            totalReadCount += result.readCount;
+            remainingSize -= result.readCount;
+            if(result.hitEOF)
+                return ReadBytesResult(totalReadCount, true);
+            advanceSpans(spans, spanCount, index, offset, result.readCount);
+        }
+        return ReadBytesResult(totalReadCount, false);
+    }
+    ReadBytesResult readVDirect(const ByteSpan *spans,
+                                std::size_t spanCount,
+                                std::size_t index,
+                                std::size_t offset,
+                                std::size_t totalReadCount)
+    {
+        bufferStart = 0;
+        bufferEnd = 0;
+        ::iovec iovecs[maxIOVecCount];
+        while(true)
+        {
+            std::size_t iovecCount = fillIOVecs(iovecs, spans, spanCount, index, offset);
+            if(iovecCount == 0)
+                return ReadBytesResult(totalReadCount, false);
+            auto result = ::readv(fd, iovecs, static_cast<int>(iovecCount));
+            if(result < 0)
+            {
+                if(errno == EINTR)
+                    continue;
+                int error = errno;
+                throw IOError(error, std::generic_category(), "readv failed");
+            }
+            if(result == 0)
+            {
+                hitEOF = true;
+                return ReadBytesResult(totalReadCount, true);
+            }
+            totalReadCount += result;
+            advanceSpans(spans, spanCount, index, offset, result);
+        }
+    }
+    void advise(FileAccessAdvice advice)
+    {
+        if(fd < 0)
+            return;
+        int posixAdvice = POSIX_FADV_NORMAL;
+        switch(advice)
+        {
+        case FileAccessAdvice::Normal:
+            posixAdvice = POSIX_FADV_NORMAL;
+            break;
+        case FileAccessAdvice::Sequential:
+            posixAdvice = POSIX_FADV_SEQUENTIAL;
+            break;
+        case FileAccessAdvice::Random:
+            posixAdvice = POSIX_FADV_RANDOM;
+            break;
+        case FileAccessAdvice::WillNeed:
+            posixAdvice = POSIX_FADV_WILLNEED;
+            break;
+        }
+        int error = ::posix_fadvise(fd, 0, 0, posixAdvice);
+        if(error != 0)
+            throw IOError(error, std::generic_category(), "posix_fadvise failed");
+    }
+    std::uint64_t getFileOffset()
+    {
+        constexprAssert(fd >= 0);
+        auto result = ::lseek(fd, 0, SEEK_CUR);
+        if(result < 0)
+        {
+            int error = errno;
+            throw IOError(error, std::generic_category(), "lseek failed");
+        }
+        return result;
+    }
+    std::uint64_t size()
+    {
+        constexprAssert(fd >= 0);
+        struct ::stat fileStatus;
+        if(::fstat(fd, &fileStatus) != 0)
+        {
+            int error = errno;
+            throw IOError(error, std::generic_category(), "fstat failed");
+        }
+        return fileStatus.st_size;
+    }
+    std::uint64_t tell()
+    {
+        // the buffer holds the bytes just before the file offset
+        return getFileOffset() - (bufferEnd - bufferStart);
+    }
+    void seek(std::uint64_t position)
+    {
+        std::uint64_t fileSize = size();
+        if(position > fileSize)
+            position = fileSize;
+        std::uint64_t fileOffset = getFileOffset();
+        if(position <= fileOffset && fileOffset - position <= bufferEnd)
+        {
+            bufferStart = bufferEnd - (fileOffset - position);
+            return;
+        }
+        if(::lseek(fd, static_cast<::off_t>(position), SEEK_SET) < 0)
+        {
+            int error = errno;
+            throw IOError(error, std::generic_category(), "lseek failed");
+        }
+        bufferStart = 0;
+        bufferEnd = 0;
+        hitEOF = false;
+    }
+    void close()
+    {
+        if(fd < 0)
+            return;
+        int result = ::close(fd);
+        fd = -1;
+        if(result != 0 && errno != EINTR)
+            throw IOError(errno, std::generic_category(), "close failed");
+    }
+    ~Implementation()
+    {
+        if(fd >= 0)
+            ::close(fd);
+    }
+};
+
+FileInputStream::FileInputStream(std::string fileName)
+{
+    int fd = openFile(fileName, O_RDONLY);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    try
+    {
+        implementation = new Implementation(fd);
+    }
+    catch(...)
+    {
+        ::close(fd);
+        throw;
+    }
+}
+
+FileInputStream::~FileInputStream()
+{
+    delete implementation;
+}
+
+FileInputStream::ReadBytesResult FileInputStream::readBytes(
+    unsigned char *buffer,
+    std::size_t bufferSize,
+    const std::chrono::steady_clock::time_point *timeout)
+{
+    if(!implementation)
+        return ReadBytesResult(0, true);
+    return implementation->read(buffer, bufferSize);
+}
+
+FileInputStream::ReadBytesResult FileInputStream::readBytesV(
+    const ByteSpan *buffers,
+    std::size_t bufferCount,
+    const std::chrono::steady_clock::time_point *timeout)
+{
+    if(!implementation)
+        return ReadBytesResult(0, true);
+    return implementation->readV(buffers, bufferCount);
+}
+
+void FileInputStream::advise(FileAccessAdvice advice)
+{
+    if(implementation)
+        implementation->advise(advice);
+}
+
+void FileInputStream::seek(std::uint64_t position)
+{
+    constexprAssert(implementation);
+    implementation->seek(position);
+}
+
+std::uint64_t FileInputStream::tell()
+{
+    constexprAssert(implementation);
+    return implementation->tell();
+}
+
+std::uint64_t FileInputStream::size()
+{
+    constexprAssert(implementation);
+    return implementation->size();
+}
+
+void FileInputStream::close()
+{
+    if(implementation)
+        implementation->close();
+}
+#else
 struct FileInputStream::Implementation final
 {
     std::FILE *file;
     explicit Implementation(FILE *file) : file(file)
     {
     }
+    void seekFile(std::int64_t offset, int origin)
+    {
+#ifdef _WIN32
+        int result = ::_fseeki64(file, offset, origin);
+#else
+        int result = ::fseeko(file, static_cast<::off_t>(offset), origin);
+#endif
+        if(result != 0)
+        {
+            int error = errno;
+            throw IOError(error, std::generic_category(), "fseek failed");
+        }
+    }
+    std::uint64_t tell()
+    {
+#ifdef _WIN32
+        auto result = ::_ftelli64(file);
+#else
+        auto result = ::ftello(file);
+#endif
+        if(result < 0)
+        {
+            int error = errno;
+            throw IOError(error, std::generic_category(), "ftell failed");
+        }
+        return result;
+    }
+    std::uint64_t size()
+    {
+        std::uint64_t position = tell();
+        seekFile(0, SEEK_END);
+        std::uint64_t retval = tell();
+        seekFile(position, SEEK_SET);
+        return retval;
+    }
     void close()
     {
         if(std::fclose(file) != 0)
@@ -103,12 +521,393 @@ FileInputStream::ReadBytesResult FileInputStream::readBytes(
     return ReadBytesResult(readCount, std::feof(implementation->file));
 }
 
+void FileInputStream::advise(FileAccessAdvice advice)
+{
+}
+
+void FileInputStream::seek(std::uint64_t position)
+{
+    constexprAssert(implementation);
+    std::uint64_t fileSize = implementation->size();
+    implementation->seekFile(position < fileSize ? position : fileSize, SEEK_SET);
+}
+
+std::uint64_t FileInputStream::tell()
+{
+    constexprAssert(implementation);
+    return implementation->tell();
+}
+
+std::uint64_t FileInputStream::size()
+{
+    constexprAssert(implementation);
+    return implementation->size();
+}
+
 void FileInputStream::close()
 {
     if(implementation)
         implementation->close();
 }
 
+#endif
+
+struct MappedFileInputStream::Implementation final
+{
+    const unsigned char *data;
+    std::size_t size;
+    std::size_t position;
+    Implementation(const unsigned char *data, std::size_t size)
+        : data(data), size(size), position(0)
+    {
+    }
+    static void unmap(const unsigned char *data, std::size_t size) noexcept
+    {
+        if(!data)
+            return;
+#ifdef _WIN32
+        ::UnmapViewOfFile(data);
+#else
+        ::munmap(const_cast<unsigned char *>(data), size);
+#endif
+    }
+    void close() noexcept
+    {
+        unmap(data, size);
+        data = nullptr;
+        size = 0;
+        position = 0;
+    }
+    ~Implementation()
+    {
+        unmap(data, size);
+    }
+};
+
+MappedFileInputStream::MappedFileInputStream(std::string fileName)
+{
+    const unsigned char *data = nullptr;
+    std::size_t size = 0;
+#ifdef _WIN32
+    auto convertedFileName = util::text::stringCast<std::wstring>(fileName);
+    HANDLE file = ::CreateFileW(convertedFileName.c_str(),
+                                GENERIC_READ,
+                                FILE_SHARE_READ,
+                                nullptr,
+                                OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL,
+                                nullptr);
+    if(file == INVALID_HANDLE_VALUE)
+        throw IOError(static_cast<int>(::GetLastError()),
+                      std::system_category(),
+                      "CreateFileW failed: " + std::move(fileName));
+    LARGE_INTEGER fileSize;
+    if(!::GetFileSizeEx(file, &fileSize))
+    {
+        int error = ::GetLastError();
+        ::CloseHandle(file);
+        throw IOError(error, std::system_category(), "GetFileSizeEx failed");
+    }
+    size = static_cast<std::size_t>(fileSize.QuadPart);
+    if(size > 0)
+    {
+        HANDLE mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if(!mapping)
+        {
+            int error = ::GetLastError();
+            ::CloseHandle(file);
+            throw IOError(error, std::system_category(), "CreateFileMappingW failed");
+        }
+        data = static_cast<const unsigned char *>(
+            ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        int error = ::GetLastError();
+        ::CloseHandle(mapping);
+        if(!data)
+        {
+            ::CloseHandle(file);
+            throw IOError(error, std::system_category(), "MapViewOfFile failed");
+        }
+    }
+    ::CloseHandle(file);
+#else
+    int fd = ::open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+    {
+        int error = errno;
+        throw IOError(error, std::generic_category(), "open failed: " + std::move(fileName));
+    }
+    struct ::stat fileStatus;
+    if(::fstat(fd, &fileStatus) != 0)
+    {
+        int error = errno;
+        ::close(fd);
+        throw IOError(error, std::generic_category(), "fstat failed");
+    }
+    size = static_cast<std::size_t>(fileStatus.st_size);
+    if(size > 0)
+    {
+        void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapping == MAP_FAILED)
+        {
+            int error = errno;
+            ::close(fd);
+            throw IOError(error, std::generic_category(), "mmap failed");
+        }
+        data = static_cast<const unsigned char *>(mapping);
+    }
+    ::close(fd);
+#endif
+    try
+    {
+        implementation = new Implementation(data, size);
+    }
+    catch(...)
+    {
+        Implementation::unmap(data, size);
+        throw;
+    }
+}
+
+MappedFileInputStream::~MappedFileInputStream()
+{
+    delete implementation;
+}
+
+MappedFileInputStream::ReadBytesResult MappedFileInputStream::readBytes(
+    unsigned char *buffer,
+    std::size_t bufferSize,
+    const std::chrono::steady_clock::time_point *timeout)
+{
+    if(!implementation)
+        return ReadBytesResult(0, true);
+    std::size_t remaining = implementation->size - implementation->position;
+    if(bufferSize > remaining)
+        bufferSize = remaining;
+    if(bufferSize > 0)
+        std::memcpy(buffer, implementation->data + implementation->position, bufferSize);
+    implementation->position += bufferSize;
+    return ReadBytesResult(bufferSize, implementation->position >= implementation->size);
+}
+
+MappedFileInputStream::PeekContiguousResult MappedFileInputStream::peekContiguous()
+{
+    if(!implementation)
+        return PeekContiguousResult(nullptr, 0, true);
+    return PeekContiguousResult(implementation->data + implementation->position,
+                                implementation->size - implementation->position,
+                                true);
+}
+
+void MappedFileInputStream::consume(std::size_t count)
+{
+    if(!implementation)
+    {
+        constexprAssert(count == 0);
+        return;
+    }
+    constexprAssert(count <= implementation->size - implementation->position);
+    implementation->position += count;
+}
+
+void MappedFileInputStream::seek(std::uint64_t position)
+{
+    if(!implementation)
+        return;
+    implementation->position =
+        position < implementation->size ? position : implementation->size;
+}
+
+std::uint64_t MappedFileInputStream::tell()
+{
+    return implementation ? implementation->position : 0;
+}
+
+std::uint64_t MappedFileInputStream::size()
+{
+    return implementation ? implementation->size : 0;
+}
+
+void MappedFileInputStream::advise(FileAccessAdvice advice)
+{
+#ifndef _WIN32
+    if(!implementation || !implementation->data)
+        return;
+    int posixAdvice = POSIX_MADV_NORMAL;
+    switch(advice)
+    {
+    case FileAccessAdvice::Normal:
+        posixAdvice = POSIX_MADV_NORMAL;
+        break;
+    case FileAccessAdvice::Sequential:
+        posixAdvice = POSIX_MADV_SEQUENTIAL;
+        break;
+    case FileAccessAdvice::Random:
+        posixAdvice = POSIX_MADV_RANDOM;
+        break;
+    case FileAccessAdvice::WillNeed:
+        posixAdvice = POSIX_MADV_WILLNEED;
+        break;
+    }
+    int error = ::posix_madvise(
+        const_cast<unsigned char *>(implementation->data), implementation->size, posixAdvice);
+    if(error != 0)
+        throw IOError(error, std::generic_category(), "posix_madvise failed");
+#endif
+}
+
+void MappedFileInputStream::close()
+{
+    if(implementation)
+        implementation->close();
+}
+
+#ifdef __linux
+struct FileOutputStream::Implementation final
+{
+    int fd;
+    std::unique_ptr<unsigned char[]> buffer;
+    std::size_t bufferUsed = 0;
+    explicit Implementation(int fd) : fd(fd), buffer(new unsigned char[fileBufferSize])
+    {
+    }
+    void write(const unsigned char *writeBuffer, std::size_t writeBufferSize)
+    {
+        constexprAssert(fd >= 0);
+        if(writeBufferSize == 0)
+            return;
+        if(bufferUsed + writeBufferSize <= fileBufferSize)
+        {
+            std::memcpy(buffer.get() + bufferUsed, writeBuffer, writeBufferSize);
+            bufferUsed += writeBufferSize;
+            return;
+        }
+        flush();
+        // big writes go straight from the caller's buffer
+        if(writeBufferSize >= fileBufferSize)
+        {
+            writeFully(fd, writeBuffer, writeBufferSize);
+            return;
+        }
+        std::memcpy(buffer.get(), writeBuffer, writeBufferSize);
+        bufferUsed = writeBufferSize;
+    }
+    void writeV(const ConstByteSpan *spans, std::size_t spanCount)
+    {
+        constexprAssert(fd >= 0);
+        std::size_t totalSize = 0;
+        for(std::size_t i = 0; i < spanCount; i++)
+            totalSize += spans[i].size;
+        if(totalSize < fileBufferSize)
+        {
+            for(std::size_t i = 0; i < spanCount; i++)
+                write(spans[i].data, spans[i].size);
+            return;
+        }
+        flush();
+        ::iovec iovecs[maxIOVecCount];
+        std::size_t index = 0;
+        std::size_t offset = 0;
+        while(true)
+        {
+            std::size_t iovecCount = fillIOVecs(iovecs, spans, spanCount, index, offset);
+            if(iovecCount == 0)
+                return;
+            auto result = ::writev(fd, iovecs, static_cast<int>(iovecCount));
+            if(result < 0)
+            {
+                if(errno == EINTR)
+                    continue;
+                int error = errno;
+                throw IOError(error, std::generic_category(), "writev failed");
+            }
+            advanceSpans(spans, spanCount, index, offset, result);
+        }
+    }
+    void flush()
+    {
+        if(fd < 0 || bufferUsed == 0)
+            return;
+        std::size_t size = bufferUsed;
+        bufferUsed = 0;
+        writeFully(fd, buffer.get(), size);
+    }
+    void close()
+    {
+        if(fd < 0)
+            return;
+        try
+        {
+            flush();
+        }
+        catch(...)
+        {
+            ::close(fd);
+            fd = -1;
+            throw;
+        }
+        int result = ::close(fd);
+        fd = -1;
+        if(result != 0 && errno != EINTR)
+            throw IOError(errno, std::generic_category(), "close failed");
+    }
+    ~Implementation()
+    {
+        if(fd < 0)
+            return;
+        try
+        {
+            flush();
+        }
+        catch(IOError &)
+        {
+        }
+        ::close(fd);
+    }
+};
+
+FileOutputStream::FileOutputStream(std::string fileName)
+{
+    int fd = openFile(fileName, O_WRONLY | O_CREAT | O_TRUNC);
+    try
+    {
+        implementation = new Implementation(fd);
+    }
+    catch(...)
+    {
+        ::close(fd);
+        throw;
+    }
+}
+
+FileOutputStream::~FileOutputStream()
+{
+    delete implementation;
+}
+
+void FileOutputStream::writeBytes(const unsigned char *buffer, std::size_t bufferSize)
+{
+    constexprAssert(implementation);
+    implementation->write(buffer, bufferSize);
+}
+
+void FileOutputStream::writeBytesV(const ConstByteSpan *buffers, std::size_t bufferCount)
+{
+    constexprAssert(implementation);
+    implementation->writeV(buffers, bufferCount);
+}
+
+void FileOutputStream::flush()
+{
+    if(implementation)
+        implementation->flush();
+}
+
+void FileOutputStream::close()
+{
+    if(implementation)
+        implementation->close();
+}
+#else
 struct FileOutputStream::Implementation final
 {
     std::FILE *file;
@@ -188,6 +987,7 @@ void FileOutputStream::close()
     if(implementation)
         implementation->close();
 }
+#endif
 }
 }
 }
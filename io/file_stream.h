@@ -33,6 +33,15 @@ namespace voxels
 {
 namespace io
 {
+/** how a file is going to be read */
+enum class FileAccessAdvice
+{
+    Normal,
+    Sequential,
+    Random,
+    WillNeed,
+};
+
 class FileInputStream final : public InputStream
 {
 private:
@@ -59,6 +68,69 @@ public:
         unsigned char *buffer,
         std::size_t bufferSize,
         const std::chrono::steady_clock::time_point *timeout) override;
+#ifdef __linux
+    virtual ReadBytesResult readBytesV(
+        const ByteSpan *buffers,
+        std::size_t bufferCount,
+        const std::chrono::steady_clock::time_point *timeout) override;
+#endif
+    /** tells the kernel how the file will be read; has no effect where unsupported. Files start
+     * out read sequentially */
+    void advise(FileAccessAdvice advice);
+    virtual bool isSeekable() const noexcept override
+    {
+        return true;
+    }
+    /** keeps the buffered data when position is within it */
+    virtual void seek(std::uint64_t position) override;
+    virtual std::uint64_t tell() override;
+    virtual std::uint64_t size() override;
+    void close();
+};
+
+/** reads a file through a read-only memory mapping */
+class MappedFileInputStream final : public InputStream
+{
+private:
+    struct Implementation;
+
+private:
+    Implementation *implementation;
+
+public:
+    explicit MappedFileInputStream(std::string fileName);
+    virtual ~MappedFileInputStream();
+    MappedFileInputStream(MappedFileInputStream &&rt) noexcept
+        : InputStream(std::move(rt)),
+          implementation(rt.implementation)
+    {
+        rt.implementation = nullptr;
+    }
+    MappedFileInputStream &operator=(MappedFileInputStream rt) noexcept
+    {
+        InputStream::operator=(std::move(rt));
+        std::swap(implementation, rt.implementation);
+        return *this;
+    }
+    virtual ReadBytesResult readBytes(
+        unsigned char *buffer,
+        std::size_t bufferSize,
+        const std::chrono::steady_clock::time_point *timeout) override;
+    virtual bool canPeekContiguous() const noexcept override
+    {
+        return true;
+    }
+    virtual PeekContiguousResult peekContiguous() override;
+    virtual void consume(std::size_t count) override;
+    /** tells the kernel how the mapping will be read; has no effect where unsupported */
+    void advise(FileAccessAdvice advice);
+    virtual bool isSeekable() const noexcept override
+    {
+        return true;
+    }
+    virtual void seek(std::uint64_t position) override;
+    virtual std::uint64_t tell() override;
+    virtual std::uint64_t size() override;
     void close();
 };
 
@@ -85,6 +157,9 @@ public:
         return *this;
     }
     virtual void writeBytes(const unsigned char *buffer, std::size_t bufferSize) override;
+#ifdef __linux
+    virtual void writeBytesV(const ConstByteSpan *buffers, std::size_t bufferCount) override;
+#endif
     virtual void flush() override;
     void close();
 };
@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#ifndef IO_HASHING_STREAM_H_
+#define IO_HASHING_STREAM_H_
+
+#include "input_stream.h"
+#include "output_stream.h"
+#include "../util/hash.h"
+#include "../util/constexpr_assert.h"
+#include <memory>
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace io
+{
+/** which digests a hashing stream computes */
+enum class StreamHashes
+{
+    XXHash64 = 1,
+    CRC32 = 2,
+    All = XXHash64 | CRC32,
+};
+
+/** the digests of the bytes that went through a hashing stream */
+class StreamHasher final
+{
+private:
+    util::hash::XXHash64 xxHash64;
+    util::hash::CRC32 crc32;
+    bool useXXHash64;
+    bool useCRC32;
+
+public:
+    explicit StreamHasher(StreamHashes hashes) noexcept
+        : xxHash64(),
+          crc32(),
+          useXXHash64(static_cast<int>(hashes) & static_cast<int>(StreamHashes::XXHash64)),
+          useCRC32(static_cast<int>(hashes) & static_cast<int>(StreamHashes::CRC32))
+    {
+    }
+    void update(const unsigned char *data, std::size_t size) noexcept
+    {
+        if(useXXHash64)
+            xxHash64.update(data, size);
+        if(useCRC32)
+            crc32.update(data, size);
+    }
+    std::uint64_t getXXHash64() const noexcept
+    {
+        constexprAssert(useXXHash64);
+        return xxHash64.digest();
+    }
+    std::uint32_t getCRC32() const noexcept
+    {
+        constexprAssert(useCRC32);
+        return crc32.digest();
+    }
+};
+
+/** hashes the bytes read through it, so data can be verified in the same pass that parses it */
+class HashingInputStream final : public InputStream
+{
+private:
+    std::shared_ptr<InputStream> stream;
+    StreamHasher hasher;
+
+public:
+    explicit HashingInputStream(std::shared_ptr<InputStream> stream,
+                                StreamHashes hashes = StreamHashes::All)
+        : stream(std::move(stream)), hasher(hashes)
+    {
+    }
+    virtual ReadBytesResult readBytes(unsigned char *buffer,
+                                      std::size_t bufferSize,
+                                      const std::chrono::steady_clock::time_point *timeout) override
+    {
+        auto retval = stream->readBytes(buffer, bufferSize, timeout);
+        hasher.update(buffer, retval.readCount);
+        return retval;
+    }
+    /** reads asynchronously however the underlying stream does */
+    virtual void readBytesAsync(unsigned char *buffer,
+                                std::size_t bufferSize,
+                                util::Executor &executor,
+                                ReadBytesCallback callback) override
+    {
+        stream->readBytesAsync(buffer,
+                               bufferSize,
+                               executor,
+                               [this, buffer, callback](ReadBytesResult result,
+                                                        std::exception_ptr error)
+                               {
+                                   if(!error)
+                                       hasher.update(buffer, result.readCount);
+                                   callback(result, error);
+                               });
+    }
+    virtual void cancelReadBytesAsync() override
+    {
+        stream->cancelReadBytesAsync();
+    }
+    virtual ReadBytesResult readBytesV(
+        const ByteSpan *buffers,
+        std::size_t bufferCount,
+        const std::chrono::steady_clock::time_point *timeout) override
+    {
+        auto retval = stream->readBytesV(buffers, bufferCount, timeout);
+        std::size_t left = retval.readCount;
+        for(std::size_t i = 0; i < bufferCount && left > 0; i++)
+        {
+            std::size_t size = buffers[i].size < left ? buffers[i].size : left;
+            hasher.update(buffers[i].data, size);
+            left -= size;
+        }
+        return retval;
+    }
+    virtual bool canPeekContiguous() const noexcept override
+    {
+        return stream->canPeekContiguous();
+    }
+    virtual PeekContiguousResult peekContiguous() override
+    {
+        return stream->peekContiguous();
+    }
+    /** hashes the consumed bytes straight out of the underlying stream's buffer */
+    virtual void consume(std::size_t count) override
+    {
+        if(count > 0)
+            hasher.update(stream->peekContiguous().data, count);
+        stream->consume(count);
+    }
+    /** the digests of all the bytes read so far; the digests of the whole stream once the end is
+     * reached */
+    const StreamHasher &getHasher() const noexcept
+    {
+        return hasher;
+    }
+    std::uint64_t getXXHash64() const noexcept
+    {
+        return hasher.getXXHash64();
+    }
+    std::uint32_t getCRC32() const noexcept
+    {
+        return hasher.getCRC32();
+    }
+};
+
+/** hashes the bytes written through it */
+class HashingOutputStream final : public OutputStream
+{
+private:
+    std::shared_ptr<OutputStream> stream;
+    StreamHasher hasher;
+
+public:
+    explicit HashingOutputStream(std::shared_ptr<OutputStream> stream,
+                                 StreamHashes hashes = StreamHashes::All)
+        : stream(std::move(stream)), hasher(hashes)
+    {
+    }
+    virtual void writeBytes(const unsigned char *buffer, std::size_t bufferSize) override
+    {
+        hasher.update(buffer, bufferSize);
+        stream->writeBytes(buffer, bufferSize);
+    }
+    virtual void writeBytesV(const ConstByteSpan *buffers, std::size_t bufferCount) override
+    {
+        for(std::size_t i = 0; i < bufferCount; i++)
+            hasher.update(buffers[i].data, buffers[i].size);
+        stream->writeBytesV(buffers, bufferCount);
+    }
+    virtual void flush() override
+    {
+        stream->flush();
+    }
+    const StreamHasher &getHasher() const noexcept
+    {
+        return hasher;
+    }
+    std::uint64_t getXXHash64() const noexcept
+    {
+        return hasher.getXXHash64();
+    }
+    std::uint32_t getCRC32() const noexcept
+    {
+        return hasher.getCRC32();
+    }
+};
+}
+}
+}
+
+#endif /* IO_HASHING_STREAM_H_ */
@@ -23,10 +23,15 @@
 #define IO_INPUT_STREAM_H_
 
 #include "stream_base.h"
+#include "typed_reader.h"
 #include <cstdint>
 #include <type_traits>
 #include <chrono>
 #include <limits>
+#include <functional>
+#include <future>
+#include <exception>
+#include "../util/executor.h"
 
 namespace programmerjake
 {
@@ -34,7 +39,7 @@ namespace voxels
 {
 namespace io
 {
-struct InputStream : virtual public StreamBase
+struct InputStream : virtual public StreamBase, public TypedReader<InputStream>
 {
     struct ReadBytesResult
     {
@@ -45,9 +50,127 @@ struct InputStream : virtual public StreamBase
         {
         }
     };
+    struct PeekContiguousResult
+    {
+        const unsigned char *data;
+        std::size_t size;
+        bool hitEOF;
+        constexpr PeekContiguousResult(const unsigned char *data, std::size_t size, bool hitEOF)
+            : data(data), size(size), hitEOF(hitEOF)
+        {
+        }
+    };
+    /** called with the result, or with the exception the read threw */
+    typedef std::function<void(ReadBytesResult result, std::exception_ptr error)>
+        ReadBytesCallback;
     virtual ReadBytesResult readBytes(unsigned char *buffer,
                                       std::size_t bufferSize,
                                       const std::chrono::steady_clock::time_point *timeout) = 0;
+    /** starts reading into buffer, then calls callback on executor when done. This stream,
+     * buffer and executor must stay valid until callback is called, and only one read may be in
+     * progress at a time. The default runs readBytes as a task on executor, parking one of its
+     * threads until the read finishes, so pass an executor whose threads may block, like
+     * util::ThreadPoolExecutor::getBlockingIOExecutor(). Streams that can wait without a thread,
+     * like DescriptorStream, override this.
+     */
+    virtual void readBytesAsync(unsigned char *buffer,
+                                std::size_t bufferSize,
+                                util::Executor &executor,
+                                ReadBytesCallback callback)
+    {
+        executor.execute([this, buffer, bufferSize, callback]()
+                         {
+                             ReadBytesResult result(0, false);
+                             std::exception_ptr error;
+                             try
+                             {
+                                 result = readBytes(buffer, bufferSize, nullptr);
+                             }
+                             catch(...)
+                             {
+                                 error = std::current_exception();
+                             }
+                             callback(result, error);
+                         });
+    }
+    /** asks the read started by readBytesAsync to finish early; its callback then gets an
+     * operation_canceled IOError. A readBytes running on an executor thread can't be interrupted,
+     * so by default this does nothing and the read finishes normally.
+     */
+    virtual void cancelReadBytesAsync()
+    {
+    }
+    /** reads into each of buffers in turn. Like readBytes, it only stops before filling all of
+     * them at the end of the stream or when timeout is reached.
+     * @return the total number of bytes read
+     */
+    virtual ReadBytesResult readBytesV(const ByteSpan *buffers,
+                                       std::size_t bufferCount,
+                                       const std::chrono::steady_clock::time_point *timeout)
+    {
+        std::size_t totalReadCount = 0;
+        for(std::size_t i = 0; i < bufferCount; i++)
+        {
+            unsigned char *buffer = buffers[i].data;
+            std::size_t bufferSize = buffers[i].size;
+            while(bufferSize > 0)
+            {
+                auto result = readBytes(buffer, bufferSize, timeout);
+                totalReadCount += result.readCount;
+                buffer += result.readCount;
+                bufferSize -= result.readCount;
+                if(result.hitEOF)
+                    return ReadBytesResult(totalReadCount, true);
+                if(bufferSize > 0 && timeout)
+                    return ReadBytesResult(totalReadCount, false);
+            }
+        }
+        return ReadBytesResult(totalReadCount, false);
+    }
+    /** @return true if this stream implements peekContiguous and consume */
+    virtual bool canPeekContiguous() const noexcept
+    {
+        return false;
+    }
+    /** returns the next bytes of the stream from its own storage without advancing. Blocks until
+     * at least one byte is available or the end of the stream is reached. The returned memory is
+     * valid until the next call that isn't const.
+     */
+    virtual PeekContiguousResult peekContiguous()
+    {
+        throw IOError(std::make_error_code(std::errc::operation_not_supported),
+                      "peekContiguous not supported");
+    }
+    /** advances past the first count bytes returned by the last peekContiguous call */
+    virtual void consume(std::size_t count)
+    {
+        throw IOError(std::make_error_code(std::errc::operation_not_supported),
+                      "consume not supported");
+    }
+    /** @return true if this stream implements seek, tell and size */
+    virtual bool isSeekable() const noexcept
+    {
+        return false;
+    }
+    /** moves to position bytes from the start of the stream; positions past the end are clamped
+     * to the end */
+    virtual void seek(std::uint64_t position)
+    {
+        throw IOError(std::make_error_code(std::errc::operation_not_supported),
+                      "seek not supported");
+    }
+    /** @return the current position in bytes from the start of the stream */
+    virtual std::uint64_t tell()
+    {
+        throw IOError(std::make_error_code(std::errc::operation_not_supported),
+                      "tell not supported");
+    }
+    /** @return the length of the whole stream in bytes */
+    virtual std::uint64_t size()
+    {
+        throw IOError(std::make_error_code(std::errc::operation_not_supported),
+                      "size not supported");
+    }
     ReadBytesResult readBytes(unsigned char *buffer, std::size_t bufferSize)
     {
         return readBytes(buffer, bufferSize, nullptr);
@@ -58,6 +181,28 @@ struct InputStream : virtual public StreamBase
     {
         return readBytes(buffer, bufferSize, &timeout);
     }
+    ReadBytesResult readBytesV(const ByteSpan *buffers, std::size_t bufferCount)
+    {
+        return readBytesV(buffers, bufferCount, nullptr);
+    }
+    std::future<ReadBytesResult> readBytesAsync(unsigned char *buffer,
+                                                std::size_t bufferSize,
+                                                util::Executor &executor)
+    {
+        auto promise = std::make_shared<std::promise<ReadBytesResult>>();
+        auto retval = promise->get_future();
+        readBytesAsync(buffer,
+                       bufferSize,
+                       executor,
+                       [promise](ReadBytesResult result, std::exception_ptr error)
+                       {
+                           if(error)
+                               promise->set_exception(error);
+                           else
+                               promise->set_value(result);
+                       });
+        return retval;
+    }
     ReadBytesResult readAvailableBytes(unsigned char *buffer, std::size_t bufferSize)
     {
         return readBytes(buffer, bufferSize, std::chrono::steady_clock::time_point::min());
@@ -80,90 +225,6 @@ struct InputStream : virtual public StreamBase
             throw EOFError();
         return retval;
     }
-    unsigned char readByte()
-    {
-        unsigned char retval;
-        readAllBytes(&retval, 1);
-        return retval;
-    }
-    bool readBool()
-    {
-        return readByte() != 0;
-    }
-    static_assert(std::is_same<std::uint8_t, unsigned char>::value, "");
-    std::uint8_t readU8()
-    {
-        return readByte();
-    }
-    std::int8_t readS8()
-    {
-        return readU8();
-    }
-    std::uint16_t readU16()
-    {
-        const std::size_t byteCount = 2;
-        std::uint8_t bytes[byteCount];
-        readAllBytes(bytes, byteCount);
-        return (static_cast<std::uint16_t>(bytes[1]) << 8) | bytes[0];
-    }
-    std::int16_t readS16()
-    {
-        return readU16();
-    }
-    std::uint32_t readU32()
-    {
-        const std::size_t byteCount = 4;
-        std::uint8_t bytes[byteCount];
-        readAllBytes(bytes, byteCount);
-        return (static_cast<std::uint32_t>(bytes[3]) << 24)
-               | (static_cast<std::uint32_t>(bytes[2]) << 16)
-               | (static_cast<std::uint32_t>(bytes[1]) << 8) | bytes[0];
-    }
-    std::int32_t readS32()
-    {
-        return readU32();
-    }
-    std::uint64_t readU64()
-    {
-        const std::size_t byteCount = 8;
-        std::uint8_t bytes[byteCount];
-        readAllBytes(bytes, byteCount);
-        return (static_cast<std::uint64_t>(bytes[7]) << 56)
-               | (static_cast<std::uint64_t>(bytes[6]) << 48)
-               | (static_cast<std::uint64_t>(bytes[5]) << 40)
-               | (static_cast<std::uint64_t>(bytes[4]) << 32)
-               | (static_cast<std::uint64_t>(bytes[3]) << 24)
-               | (static_cast<std::uint64_t>(bytes[2]) << 16)
-               | (static_cast<std::uint64_t>(bytes[1]) << 8) | bytes[0];
-    }
-    std::int64_t readS64()
-    {
-        return readU64();
-    }
-    float readF32()
-    {
-        static_assert(
-            std::numeric_limits<float>::is_iec559 && sizeof(float) == sizeof(std::uint32_t), "");
-        union
-        {
-            float f;
-            std::uint32_t i;
-        } u;
-        u.i = readU32();
-        return u.f;
-    }
-    double readF64()
-    {
-        static_assert(
-            std::numeric_limits<double>::is_iec559 && sizeof(double) == sizeof(std::uint64_t), "");
-        union
-        {
-            double f;
-            std::uint64_t i;
-        } u;
-        u.i = readU64();
-        return u.f;
-    }
 };
 }
 }
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#include "line_reader.h"
+#include <cstring>
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace io
+{
+DelimitedReader::DelimitedReader(std::shared_ptr<InputStream> stream,
+                                 util::ByteSet delimiters,
+                                 bool skipEmptyFields,
+                                 std::size_t bufferSize)
+    : stream(std::move(stream)),
+      delimiters(delimiters),
+      skipEmptyFields(skipEmptyFields),
+      buffer(),
+      bufferCapacity(bufferSize > 0 ? bufferSize : 1),
+      start(0),
+      scanned(0),
+      end(0),
+      streamHitEOF(false)
+{
+    buffer.reset(new unsigned char[bufferCapacity]);
+}
+
+void DelimitedReader::fill()
+{
+    if(start > 0)
+    {
+        if(end > start)
+            std::memmove(buffer.get(), buffer.get() + start, end - start);
+        end -= start;
+        scanned -= start;
+        start = 0;
+    }
+    if(end == bufferCapacity)
+    {
+        std::size_t newCapacity = bufferCapacity * 2;
+        std::unique_ptr<unsigned char[]> newBuffer(new unsigned char[newCapacity]);
+        std::memcpy(newBuffer.get(), buffer.get(), end);
+        buffer = std::move(newBuffer);
+        bufferCapacity = newCapacity;
+    }
+    auto result = stream->readBytes(buffer.get() + end, bufferCapacity - end, nullptr);
+    end += result.readCount;
+    streamHitEOF = result.hitEOF;
+}
+
+bool DelimitedReader::readField(TextSpan &field, int *delimiter)
+{
+    if(skipEmptyFields)
+    {
+        while(true)
+        {
+            start = util::findFirstNotOf(buffer.get() + start, buffer.get() + end, delimiters)
+                    - buffer.get();
+            if(start < end || streamHitEOF)
+                break;
+            start = scanned = end = 0;
+            fill();
+        }
+        if(scanned < start)
+            scanned = start;
+    }
+    while(true)
+    {
+        const unsigned char *found =
+            util::findFirstOf(buffer.get() + scanned, buffer.get() + end, delimiters);
+        if(found != buffer.get() + end)
+        {
+            field = TextSpan(reinterpret_cast<const char *>(buffer.get() + start),
+                             found - (buffer.get() + start));
+            if(delimiter)
+                *delimiter = *found;
+            start = scanned = found - buffer.get() + 1;
+            return true;
+        }
+        scanned = end;
+        if(streamHitEOF)
+        {
+            if(start == end)
+                return false;
+            field = TextSpan(reinterpret_cast<const char *>(buffer.get() + start), end - start);
+            if(delimiter)
+                *delimiter = -1;
+            start = end;
+            return true;
+        }
+        fill();
+    }
+}
+}
+}
+}
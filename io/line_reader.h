@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#ifndef IO_LINE_READER_H_
+#define IO_LINE_READER_H_
+
+#include "input_stream.h"
+#include "../util/byte_search.h"
+#include <memory>
+#include <string>
+#include <cstdint>
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace io
+{
+/** a run of characters owned by someone else */
+struct TextSpan final
+{
+    const char *data;
+    std::size_t size;
+    constexpr TextSpan() : data(nullptr), size(0)
+    {
+    }
+    constexpr TextSpan(const char *data, std::size_t size) : data(data), size(size)
+    {
+    }
+    bool empty() const noexcept
+    {
+        return size == 0;
+    }
+    std::string toString() const
+    {
+        return std::string(data, size);
+    }
+};
+
+/** splits an InputStream into fields ending at any of a set of delimiter bytes. It reads blocks
+ * into its own buffer and returns spans of that buffer, so a field is only copied when it
+ * crosses the end of a block. A returned span is valid until the next call to readField.
+ */
+class DelimitedReader final
+{
+    DelimitedReader(const DelimitedReader &) = delete;
+    DelimitedReader &operator=(const DelimitedReader &) = delete;
+
+public:
+    static constexpr std::size_t defaultBufferSize = 0x10000;
+
+private:
+    std::shared_ptr<InputStream> stream;
+    util::ByteSet delimiters;
+    bool skipEmptyFields;
+    std::unique_ptr<unsigned char[]> buffer;
+    std::size_t bufferCapacity;
+    std::size_t start;
+    std::size_t scanned;
+    std::size_t end;
+    bool streamHitEOF;
+
+private:
+    /** moves the unread bytes to the start of the buffer, growing it if they fill it, then
+     * reads more
+     */
+    void fill();
+
+public:
+    /** @param skipEmptyFields if true, runs of delimiters are treated as one delimiter and
+     * leading delimiters are skipped
+     */
+    DelimitedReader(std::shared_ptr<InputStream> stream,
+                    util::ByteSet delimiters,
+                    bool skipEmptyFields,
+                    std::size_t bufferSize = defaultBufferSize);
+    /** @param delimiter if not null, set to the delimiter that ended the field, or -1 if the
+     * field ended at the end of the stream
+     * @return false if there are no more fields
+     */
+    bool readField(TextSpan &field, int *delimiter = nullptr);
+};
+
+/** reads lines ending in "\n" or "\r\n"; the returned lines don't include the line ending */
+class LineReader final
+{
+private:
+    DelimitedReader reader;
+    std::uint64_t lineNumber;
+
+public:
+    explicit LineReader(std::shared_ptr<InputStream> stream,
+                        std::size_t bufferSize = DelimitedReader::defaultBufferSize)
+        : reader(std::move(stream), util::ByteSet("\n"), false, bufferSize), lineNumber(0)
+    {
+    }
+    /** @return false if there are no more lines */
+    bool readLine(TextSpan &line)
+    {
+        if(!reader.readField(line))
+            return false;
+        if(line.size > 0 && line.data[line.size - 1] == '\r')
+            line.size--;
+        lineNumber++;
+        return true;
+    }
+    /** @return the 1-based number of the last line read */
+    std::uint64_t getLineNumber() const noexcept
+    {
+        return lineNumber;
+    }
+};
+
+/** reads tokens separated by runs of delimiters, whitespace by default */
+class TokenReader final
+{
+private:
+    DelimitedReader reader;
+
+public:
+    explicit TokenReader(std::shared_ptr<InputStream> stream,
+                         const char *delimiters = " \t\r\n",
+                         std::size_t bufferSize = DelimitedReader::defaultBufferSize)
+        : reader(std::move(stream), util::ByteSet(delimiters), true, bufferSize)
+    {
+    }
+    /** @return false if there are no more tokens */
+    bool readToken(TextSpan &token)
+    {
+        return reader.readField(token);
+    }
+};
+}
+}
+}
+
+#endif /* IO_LINE_READER_H_ */
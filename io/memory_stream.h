@@ -24,8 +24,11 @@
 
 #include "input_stream.h"
 #include "output_stream.h"
+#include "concat_stream.h"
 #include <memory>
 #include <vector>
+#include <cstring>
+#include "../util/constexpr_assert.h"
 
 namespace programmerjake
 {
@@ -33,6 +36,14 @@ namespace voxels
 {
 namespace io
 {
+/** tag selecting the MemoryInputStream constructor that reads from memory the caller keeps alive
+ * instead of copying it */
+struct BorrowMemoryTag final
+{
+};
+
+constexpr BorrowMemoryTag borrowMemory{};
+
 class MemoryInputStream final : public InputStream
 {
 private:
@@ -61,18 +72,77 @@ public:
               memoryBuffer, memoryBuffer + memoryBufferSize))
     {
     }
+    /** doesn't copy or allocate; memoryBuffer must outlive this stream */
+    MemoryInputStream(BorrowMemoryTag,
+                      const unsigned char *memoryBuffer,
+                      std::size_t memoryBufferSize) noexcept
+        : MemoryInputStream(std::shared_ptr<const unsigned char>(std::shared_ptr<void>(),
+                                                                 memoryBuffer),
+                            memoryBufferSize)
+    {
+    }
     virtual ReadBytesResult readBytes(unsigned char *buffer,
                                       std::size_t bufferSize,
                                       const std::chrono::steady_clock::time_point *timeout) override
     {
         if(bufferSize > memoryBufferSize - position)
             bufferSize = memoryBufferSize - position;
-        for(std::size_t i = 0; i < bufferSize; i++)
-        {
-            buffer[i] = memoryBuffer.get()[position++];
-        }
+        if(bufferSize > 0)
+            std::memcpy(buffer, memoryBuffer.get() + position, bufferSize);
+        position += bufferSize;
         return ReadBytesResult(bufferSize, position >= memoryBufferSize);
     }
+    virtual ReadBytesResult readBytesV(const ByteSpan *buffers,
+                                       std::size_t bufferCount,
+                                       const std::chrono::steady_clock::time_point *timeout) override
+    {
+        std::size_t totalReadCount = 0;
+        for(std::size_t i = 0; i < bufferCount && position < memoryBufferSize; i++)
+            totalReadCount += readBytes(buffers[i].data, buffers[i].size, timeout).readCount;
+        return ReadBytesResult(totalReadCount, position >= memoryBufferSize);
+    }
+    /** copies on the calling thread; only the callback goes to executor */
+    virtual void readBytesAsync(unsigned char *buffer,
+                                std::size_t bufferSize,
+                                util::Executor &executor,
+                                ReadBytesCallback callback) override
+    {
+        ReadBytesResult result = readBytes(buffer, bufferSize, nullptr);
+        executor.execute([result, callback]()
+                         {
+                             callback(result, std::exception_ptr());
+                         });
+    }
+    virtual bool canPeekContiguous() const noexcept override
+    {
+        return true;
+    }
+    virtual PeekContiguousResult peekContiguous() override
+    {
+        return PeekContiguousResult(
+            memoryBuffer.get() + position, memoryBufferSize - position, true);
+    }
+    virtual void consume(std::size_t count) override
+    {
+        constexprAssert(count <= memoryBufferSize - position);
+        position += count;
+    }
+    virtual bool isSeekable() const noexcept override
+    {
+        return true;
+    }
+    virtual void seek(std::uint64_t position) override
+    {
+        this->position = position < memoryBufferSize ? position : memoryBufferSize;
+    }
+    virtual std::uint64_t tell() override
+    {
+        return position;
+    }
+    virtual std::uint64_t size() override
+    {
+        return memoryBufferSize;
+    }
 };
 
 class MemoryOutputStream final : public OutputStream
@@ -92,6 +162,20 @@ public:
     {
         outputBuffer.insert(outputBuffer.end(), buffer, buffer + bufferSize);
     }
+    virtual void writeBytesV(const ConstByteSpan *buffers, std::size_t bufferCount) override
+    {
+        std::size_t totalSize = outputBuffer.size();
+        for(std::size_t i = 0; i < bufferCount; i++)
+            totalSize += buffers[i].size;
+        if(totalSize > outputBuffer.capacity())
+        {
+            std::size_t newCapacity = outputBuffer.capacity() * 2;
+            outputBuffer.reserve(newCapacity > totalSize ? newCapacity : totalSize);
+        }
+        for(std::size_t i = 0; i < bufferCount; i++)
+            outputBuffer.insert(
+                outputBuffer.end(), buffers[i].data, buffers[i].data + buffers[i].size);
+    }
     virtual void flush() override
     {
     }
@@ -102,6 +186,108 @@ public:
         return retval;
     }
 };
+
+/** collects output in a list of chunks with geometrically growing sizes, so previously written
+ * bytes are never moved
+ */
+class ChunkedMemoryOutputStream final : public OutputStream
+{
+public:
+    static constexpr std::size_t defaultInitialChunkSize = 0x1000;
+    static constexpr std::size_t maxChunkSize = 0x1000000;
+
+private:
+    struct Chunk final
+    {
+        std::shared_ptr<unsigned char> memory;
+        std::size_t capacity;
+        std::size_t used;
+        explicit Chunk(std::size_t capacity)
+            : memory(new unsigned char[capacity], std::default_delete<unsigned char[]>()),
+              capacity(capacity),
+              used(0)
+        {
+        }
+    };
+
+private:
+    std::vector<Chunk> chunks;
+    std::size_t initialChunkSize;
+    std::size_t nextChunkSize;
+    std::size_t totalSize;
+
+public:
+    explicit ChunkedMemoryOutputStream(std::size_t initialChunkSize = defaultInitialChunkSize)
+        : chunks(),
+          initialChunkSize(initialChunkSize > 0 ? initialChunkSize : 1),
+          nextChunkSize(this->initialChunkSize),
+          totalSize(0)
+    {
+    }
+    virtual void writeBytes(const unsigned char *buffer, std::size_t bufferSize) override
+    {
+        totalSize += bufferSize;
+        while(bufferSize > 0)
+        {
+            if(chunks.empty() || chunks.back().used == chunks.back().capacity)
+            {
+                chunks.emplace_back(bufferSize > nextChunkSize ? bufferSize : nextChunkSize);
+                if(nextChunkSize < maxChunkSize)
+                    nextChunkSize *= 2;
+            }
+            Chunk &chunk = chunks.back();
+            std::size_t copySize = chunk.capacity - chunk.used;
+            if(copySize > bufferSize)
+                copySize = bufferSize;
+            std::memcpy(chunk.memory.get() + chunk.used, buffer, copySize);
+            chunk.used += copySize;
+            buffer += copySize;
+            bufferSize -= copySize;
+        }
+    }
+    virtual void flush() override
+    {
+    }
+    std::size_t size() const noexcept
+    {
+        return totalSize;
+    }
+    /** @return the written bytes as a scatter-gather list; valid until releaseBuffer or
+     * destruction */
+    std::vector<ConstByteSpan> getChunks() const
+    {
+        std::vector<ConstByteSpan> retval;
+        retval.reserve(chunks.size());
+        for(const Chunk &chunk : chunks)
+            retval.emplace_back(chunk.memory.get(), chunk.used);
+        return retval;
+    }
+    /** @return a stream reading the bytes written so far; shares the chunks instead of copying
+     * them, so it stays valid after more writes or releaseBuffer
+     */
+    std::shared_ptr<InputStream> makeInputStream() const
+    {
+        if(chunks.size() == 1)
+            return std::make_shared<MemoryInputStream>(chunks[0].memory, chunks[0].used);
+        std::vector<std::shared_ptr<InputStream>> streams;
+        streams.reserve(chunks.size());
+        for(const Chunk &chunk : chunks)
+            streams.push_back(std::make_shared<MemoryInputStream>(chunk.memory, chunk.used));
+        return std::make_shared<ConcatInputStream>(std::move(streams));
+    }
+    /** flattens the written bytes into one vector and empties this stream */
+    std::vector<unsigned char> releaseBuffer()
+    {
+        std::vector<unsigned char> retval;
+        retval.reserve(totalSize);
+        for(const Chunk &chunk : chunks)
+            retval.insert(retval.end(), chunk.memory.get(), chunk.memory.get() + chunk.used);
+        chunks.clear();
+        nextChunkSize = initialChunkSize;
+        totalSize = 0;
+        return retval;
+    }
+};
 }
 }
 }
@@ -27,6 +27,7 @@
 #include <type_traits>
 #include <chrono>
 #include <limits>
+#include "../util/varint.h"
 
 namespace programmerjake
 {
@@ -38,6 +39,12 @@ struct OutputStream : virtual public StreamBase
 {
     virtual void writeBytes(const unsigned char *buffer, std::size_t bufferSize) = 0;
     virtual void flush() = 0;
+    /** writes each of buffers in turn */
+    virtual void writeBytesV(const ConstByteSpan *buffers, std::size_t bufferCount)
+    {
+        for(std::size_t i = 0; i < bufferCount; i++)
+            writeBytes(buffers[i].data, buffers[i].size);
+    }
     void writeByte(unsigned char byte)
     {
         writeBytes(&byte, 1);
@@ -125,6 +132,38 @@ struct OutputStream : virtual public StreamBase
         u.f = value;
         writeU64(u.i);
     }
+    void writeVarU64(std::uint64_t value)
+    {
+        std::uint8_t bytes[util::varint::maxVarUInt64Size];
+        writeBytes(bytes, util::varint::encodeVarUInt(value, bytes));
+    }
+    void writeVarS64(std::int64_t value)
+    {
+        writeVarU64(util::varint::zigZagEncode64(value));
+    }
+    void writeVarU32(std::uint32_t value)
+    {
+        writeVarU64(value);
+    }
+    void writeVarS32(std::int32_t value)
+    {
+        writeVarU32(util::varint::zigZagEncode32(value));
+    }
+    /** writes values as Stream VByte encoded blocks of util::varint::streamVByteBlockSize
+     * values; the count is not written
+     */
+    void writeVarU32Array(const std::uint32_t *values, std::size_t count)
+    {
+        using namespace util::varint;
+        unsigned char buffer[getStreamVByteMaxEncodedSize(streamVByteBlockSize)];
+        while(count > 0)
+        {
+            std::size_t blockCount = count < streamVByteBlockSize ? count : streamVByteBlockSize;
+            writeBytes(buffer, streamVByteEncode(values, blockCount, buffer));
+            values += blockCount;
+            count -= blockCount;
+        }
+    }
 };
 }
 }
@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#ifndef IO_READER_H_
+#define IO_READER_H_
+
+#include "input_stream.h"
+#include "typed_reader.h"
+#include <memory>
+#include <cstring>
+#include <utility>
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace io
+{
+/** Readers are concrete, non-virtual alternatives to InputStream for parsers templated on the
+ * reader type. Each provides:
+ *     std::size_t readBytes(unsigned char *buffer, std::size_t bufferSize);
+ * which blocks until bufferSize bytes are read or the end is reached, returning the count, and
+ *     std::size_t readAllBytes(unsigned char *buffer,
+ *                              std::size_t bufferSize,
+ *                              bool throwOnEarlyEOF = true);
+ * plus the typed functions from TypedReader, the same as InputStream.
+ */
+
+/** reads from memory the caller keeps alive */
+class MemoryReader final : public TypedReader<MemoryReader>
+{
+private:
+    const unsigned char *current;
+    const unsigned char *end;
+
+public:
+    MemoryReader(const unsigned char *data, std::size_t size) noexcept : current(data),
+                                                                         end(data + size)
+    {
+    }
+    std::size_t readBytes(unsigned char *buffer, std::size_t bufferSize) noexcept
+    {
+        if(static_cast<std::size_t>(end - current) >= bufferSize)
+        {
+            if(bufferSize > 0)
+                std::memcpy(buffer, current, bufferSize);
+            current += bufferSize;
+            return bufferSize;
+        }
+        std::size_t retval = end - current;
+        if(retval > 0)
+            std::memcpy(buffer, current, retval);
+        current = end;
+        return retval;
+    }
+    std::size_t readAllBytes(unsigned char *buffer,
+                             std::size_t bufferSize,
+                             bool throwOnEarlyEOF = true)
+    {
+        std::size_t retval = readBytes(buffer, bufferSize);
+        if(retval != bufferSize && throwOnEarlyEOF)
+            throw EOFError();
+        return retval;
+    }
+    std::size_t getRemainingSize() const noexcept
+    {
+        return end - current;
+    }
+};
+
+/** reads an InputStream through an inline buffer, so only refills are virtual calls. When the
+ * stream can peekContiguous its memory is read in place, and the bytes read are consumed by the
+ * time the reader is destroyed; otherwise the reader reads ahead of what it returns.
+ */
+class StreamReader final : public TypedReader<StreamReader>
+{
+    StreamReader(const StreamReader &) = delete;
+    StreamReader &operator=(const StreamReader &) = delete;
+
+public:
+    static constexpr std::size_t defaultBufferSize = 0x10000;
+
+private:
+    std::shared_ptr<InputStream> stream;
+    std::unique_ptr<unsigned char[]> buffer;
+    std::size_t bufferSize;
+    const unsigned char *start;
+    const unsigned char *current;
+    const unsigned char *end;
+    bool peeking;
+    bool streamHitEOF;
+
+private:
+    void refill()
+    {
+        if(peeking)
+        {
+            stream->consume(end - start);
+            auto result = stream->peekContiguous();
+            start = result.data;
+            end = result.data + result.size;
+            streamHitEOF = result.hitEOF;
+        }
+        else
+        {
+            auto result = stream->readBytes(buffer.get(), bufferSize, nullptr);
+            start = buffer.get();
+            end = start + result.readCount;
+            streamHitEOF = result.hitEOF;
+        }
+        current = start;
+    }
+    std::size_t readSlow(unsigned char *readBuffer, std::size_t readBufferSize)
+    {
+        std::size_t retval = 0;
+        while(true)
+        {
+            std::size_t readCount = end - current;
+            if(readCount > readBufferSize)
+                readCount = readBufferSize;
+            if(readCount > 0)
+                std::memcpy(readBuffer, current, readCount);
+            current += readCount;
+            readBuffer += readCount;
+            readBufferSize -= readCount;
+            retval += readCount;
+            if(readBufferSize == 0 || streamHitEOF)
+                return retval;
+            // big reads go straight to the caller's buffer
+            if(!peeking && readBufferSize >= bufferSize)
+            {
+                std::size_t directReadCount =
+                    stream->readAllBytes(readBuffer, readBufferSize, false);
+                streamHitEOF = directReadCount < readBufferSize;
+                return retval + directReadCount;
+            }
+            refill();
+        }
+    }
+
+public:
+    explicit StreamReader(std::shared_ptr<InputStream> stream,
+                          std::size_t bufferSize = defaultBufferSize)
+        : stream(std::move(stream)),
+          buffer(),
+          bufferSize(bufferSize > 0 ? bufferSize : 1),
+          start(nullptr),
+          current(nullptr),
+          end(nullptr),
+          peeking(this->stream->canPeekContiguous()),
+          streamHitEOF(false)
+    {
+        if(!peeking)
+            buffer.reset(new unsigned char[this->bufferSize]);
+    }
+    ~StreamReader()
+    {
+        if(peeking && current != start)
+            stream->consume(current - start);
+    }
+    std::size_t readBytes(unsigned char *readBuffer, std::size_t readBufferSize)
+    {
+        if(static_cast<std::size_t>(end - current) >= readBufferSize)
+        {
+            if(readBufferSize > 0)
+                std::memcpy(readBuffer, current, readBufferSize);
+            current += readBufferSize;
+            return readBufferSize;
+        }
+        return readSlow(readBuffer, readBufferSize);
+    }
+    std::size_t readAllBytes(unsigned char *readBuffer,
+                             std::size_t readBufferSize,
+                             bool throwOnEarlyEOF = true)
+    {
+        std::size_t retval = readBytes(readBuffer, readBufferSize);
+        if(retval != readBufferSize && throwOnEarlyEOF)
+            throw EOFError();
+        return retval;
+    }
+};
+
+/** exposes a reader as an InputStream for code that needs the dynamic interface */
+template <typename Reader>
+class ReaderInputStream final : public InputStream
+{
+private:
+    Reader reader;
+
+public:
+    template <typename... Args>
+    explicit ReaderInputStream(Args &&... args)
+        : reader(std::forward<Args>(args)...)
+    {
+    }
+    Reader &getReader() noexcept
+    {
+        return reader;
+    }
+    virtual ReadBytesResult readBytes(unsigned char *buffer,
+                                      std::size_t bufferSize,
+                                      const std::chrono::steady_clock::time_point *timeout) override
+    {
+        std::size_t readCount = reader.readBytes(buffer, bufferSize);
+        return ReadBytesResult(readCount, readCount < bufferSize);
+    }
+};
+}
+}
+}
+
+#endif /* IO_READER_H_ */
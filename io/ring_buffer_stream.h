@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#ifndef IO_RING_BUFFER_STREAM_H_
+#define IO_RING_BUFFER_STREAM_H_
+
+#include "input_output_stream.h"
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <memory>
+#include <cstring>
+#include "../util/constexpr_assert.h"
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace io
+{
+/** a bounded single-producer single-consumer pipe between two threads. One thread writes and
+ * calls closeWrite, the other reads; neither side locks or allocates unless it has to wait.
+ */
+class RingBufferStream final : public InputOutputStream
+{
+public:
+    static constexpr std::size_t defaultCapacity = 0x10000;
+
+private:
+    static constexpr std::size_t cacheLineSize = 64;
+    static constexpr std::size_t spinCount = 64;
+
+private:
+    std::unique_ptr<unsigned char[]> buffer;
+    std::size_t capacity;
+    std::size_t publishBatchSize;
+    std::mutex waitLock;
+    std::condition_variable waitCond;
+    unsigned char padding0[cacheLineSize];
+    // written by the consumer
+    std::atomic_size_t readIndex;
+    std::atomic_bool readerWaiting;
+    unsigned char padding1[cacheLineSize];
+    // written by the producer
+    std::atomic_size_t writeIndex;
+    std::atomic_bool writerWaiting;
+    std::atomic_bool writeClosed;
+    unsigned char padding2[cacheLineSize];
+    // only touched by the producer
+    std::size_t pendingWriteIndex;
+    std::size_t cachedReadIndex;
+    unsigned char padding3[cacheLineSize];
+
+private:
+    static std::size_t roundUpToPowerOf2(std::size_t value) noexcept
+    {
+        std::size_t retval = 1;
+        while(retval < value)
+            retval <<= 1;
+        return retval;
+    }
+    void wake(std::atomic_bool &waiting)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(waiting.load(std::memory_order_relaxed))
+        {
+            std::unique_lock<std::mutex> lockIt(waitLock);
+            waitCond.notify_all();
+        }
+    }
+    /** waits until done() returns true
+     * @return false if timeout was reached first
+     */
+    template <typename Fn>
+    bool waitUntil(std::atomic_bool &waiting,
+                   Fn done,
+                   const std::chrono::steady_clock::time_point *timeout)
+    {
+        for(std::size_t i = 0; i < spinCount; i++)
+        {
+            if(done())
+                return true;
+            if(timeout && *timeout <= std::chrono::steady_clock::now())
+                return false;
+            std::this_thread::yield();
+        }
+        std::unique_lock<std::mutex> lockIt(waitLock);
+        waiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool retval = true;
+        while(!done())
+        {
+            if(!timeout)
+            {
+                waitCond.wait(lockIt);
+            }
+            else if(waitCond.wait_until(lockIt, *timeout) == std::cv_status::timeout)
+            {
+                retval = done();
+                break;
+            }
+        }
+        waiting.store(false, std::memory_order_relaxed);
+        return retval;
+    }
+    void publish()
+    {
+        if(pendingWriteIndex == writeIndex.load(std::memory_order_relaxed))
+            return;
+        writeIndex.store(pendingWriteIndex, std::memory_order_release);
+        wake(readerWaiting);
+    }
+
+public:
+    /** @param capacity rounded up to a power of 2
+     * @param publishBatchSize writes are made visible to the reader once this many bytes are
+     * pending, or on flush or closeWrite; 0 publishes every writeBytes call
+     */
+    explicit RingBufferStream(std::size_t capacity = defaultCapacity,
+                              std::size_t publishBatchSize = 0)
+        : buffer(),
+          capacity(roundUpToPowerOf2(capacity)),
+          publishBatchSize(publishBatchSize < this->capacity ? publishBatchSize : this->capacity),
+          readIndex(0),
+          readerWaiting(false),
+          writeIndex(0),
+          writerWaiting(false),
+          writeClosed(false),
+          pendingWriteIndex(0),
+          cachedReadIndex(0)
+    {
+        buffer.reset(new unsigned char[this->capacity]);
+    }
+    virtual ReadBytesResult readBytes(unsigned char *buffer,
+                                      std::size_t bufferSize,
+                                      const std::chrono::steady_clock::time_point *timeout) override
+    {
+        std::size_t currentReadIndex = readIndex.load(std::memory_order_relaxed);
+        std::size_t available = writeIndex.load(std::memory_order_acquire) - currentReadIndex;
+        if(available == 0 && bufferSize > 0)
+        {
+            bool hasData = waitUntil(readerWaiting,
+                                     [&]()
+                                     {
+                                         return writeIndex.load(std::memory_order_acquire)
+                                                    != currentReadIndex
+                                                || writeClosed.load(std::memory_order_acquire);
+                                     },
+                                     timeout);
+            if(!hasData)
+                return ReadBytesResult(0, false);
+            available = writeIndex.load(std::memory_order_acquire) - currentReadIndex;
+        }
+        std::size_t readCount = available < bufferSize ? available : bufferSize;
+        std::size_t offset = currentReadIndex & (capacity - 1);
+        std::size_t firstPart = capacity - offset < readCount ? capacity - offset : readCount;
+        if(readCount > 0)
+        {
+            std::memcpy(buffer, this->buffer.get() + offset, firstPart);
+            std::memcpy(buffer + firstPart, this->buffer.get(), readCount - firstPart);
+            readIndex.store(currentReadIndex + readCount, std::memory_order_release);
+            wake(writerWaiting);
+        }
+        bool hitEOF = readCount == available && writeClosed.load(std::memory_order_acquire)
+                      && writeIndex.load(std::memory_order_acquire) == currentReadIndex + readCount;
+        return ReadBytesResult(readCount, hitEOF);
+    }
+    virtual void writeBytes(const unsigned char *buffer, std::size_t bufferSize) override
+    {
+        constexprAssert(!writeClosed.load(std::memory_order_relaxed));
+        while(bufferSize > 0)
+        {
+            std::size_t space = capacity - (pendingWriteIndex - cachedReadIndex);
+            if(space == 0)
+            {
+                cachedReadIndex = readIndex.load(std::memory_order_acquire);
+                space = capacity - (pendingWriteIndex - cachedReadIndex);
+            }
+            if(space == 0)
+            {
+                publish();
+                std::size_t fullReadIndex = cachedReadIndex;
+                waitUntil(writerWaiting,
+                          [&]()
+                          {
+                              return readIndex.load(std::memory_order_acquire) != fullReadIndex;
+                          },
+                          nullptr);
+                continue;
+            }
+            std::size_t writeCount = space < bufferSize ? space : bufferSize;
+            std::size_t offset = pendingWriteIndex & (capacity - 1);
+            std::size_t firstPart = capacity - offset < writeCount ? capacity - offset : writeCount;
+            std::memcpy(this->buffer.get() + offset, buffer, firstPart);
+            std::memcpy(this->buffer.get(), buffer + firstPart, writeCount - firstPart);
+            pendingWriteIndex += writeCount;
+            buffer += writeCount;
+            bufferSize -= writeCount;
+        }
+        if(pendingWriteIndex - writeIndex.load(std::memory_order_relaxed) >= publishBatchSize)
+            publish();
+    }
+    /** makes all written bytes visible to the reader */
+    virtual void flush() override
+    {
+        publish();
+    }
+    /** flushes and marks the end of the stream; called by the producer */
+    void closeWrite()
+    {
+        publish();
+        writeClosed.store(true, std::memory_order_release);
+        wake(readerWaiting);
+    }
+};
+}
+}
+}
+
+#endif /* IO_RING_BUFFER_STREAM_H_ */
@@ -0,0 +1,267 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#ifndef IO_SCHEMA_H_
+#define IO_SCHEMA_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace io
+{
+/** Describes a record's fixed-size little-endian encoding once, for both reading and writing:
+ *
+ *     struct Vertex
+ *     {
+ *         float x, y, z;
+ *         std::uint32_t color;
+ *     };
+ *     typedef Schema<Vertex,
+ *                    schemaField(Vertex, x),
+ *                    schemaField(Vertex, y),
+ *                    schemaField(Vertex, z),
+ *                    schemaField(Vertex, color)> VertexSchema;
+ *
+ *     Vertex vertex = readRecord<VertexSchema>(stream);
+ *
+ * Fields are encoded in the listed order with the same encoding as InputStream::readU32 and
+ * friends. A whole record is moved with one readAllBytes or writeBytes call. A schema can be
+ * used as the codec of a field to nest records.
+ */
+
+/** the encoding of one field type: a size and encode/decode functions */
+template <typename T, typename = void>
+struct FieldCodec;
+
+template <typename T>
+struct FieldCodec<T,
+                  typename std::enable_if<std::is_integral<T>::value
+                                          && !std::is_same<T, bool>::value>::type>
+{
+    static constexpr std::size_t size = sizeof(T);
+    static void encode(unsigned char *buffer, T value) noexcept
+    {
+        typedef typename std::make_unsigned<T>::type UnsignedType;
+        UnsignedType unsignedValue = static_cast<UnsignedType>(value);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        std::memcpy(buffer, &unsignedValue, size); // compiles to a single store
+#else
+        for(std::size_t i = 0; i < size; i++)
+            buffer[i] = static_cast<unsigned char>(unsignedValue >> (8 * i));
+#endif
+    }
+    static void decode(const unsigned char *buffer, T &value) noexcept
+    {
+        typedef typename std::make_unsigned<T>::type UnsignedType;
+        UnsignedType unsignedValue = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        std::memcpy(&unsignedValue, buffer, size); // compiles to a single load
+#else
+        for(std::size_t i = 0; i < size; i++)
+            unsignedValue |= static_cast<UnsignedType>(buffer[i]) << (8 * i);
+#endif
+        value = static_cast<T>(unsignedValue);
+    }
+};
+
+template <>
+struct FieldCodec<bool>
+{
+    static constexpr std::size_t size = 1;
+    static void encode(unsigned char *buffer, bool value) noexcept
+    {
+        buffer[0] = value ? 1 : 0;
+    }
+    static void decode(const unsigned char *buffer, bool &value) noexcept
+    {
+        value = buffer[0] != 0;
+    }
+};
+
+template <typename T>
+struct FieldCodec<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+    static_assert(std::numeric_limits<T>::is_iec559
+                      && (sizeof(T) == sizeof(std::uint32_t) || sizeof(T) == sizeof(std::uint64_t)),
+                  "");
+    typedef typename std::conditional<sizeof(T) == sizeof(std::uint32_t),
+                                      std::uint32_t,
+                                      std::uint64_t>::type BitsType;
+    static constexpr std::size_t size = sizeof(T);
+    static void encode(unsigned char *buffer, T value) noexcept
+    {
+        BitsType bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        FieldCodec<BitsType>::encode(buffer, bits);
+    }
+    static void decode(const unsigned char *buffer, T &value) noexcept
+    {
+        BitsType bits;
+        FieldCodec<BitsType>::decode(buffer, bits);
+        std::memcpy(&value, &bits, sizeof(bits));
+    }
+};
+
+template <typename T>
+struct FieldCodec<T, typename std::enable_if<std::is_enum<T>::value>::type>
+{
+    typedef typename std::underlying_type<T>::type UnderlyingType;
+    static constexpr std::size_t size = FieldCodec<UnderlyingType>::size;
+    static void encode(unsigned char *buffer, T value) noexcept
+    {
+        FieldCodec<UnderlyingType>::encode(buffer, static_cast<UnderlyingType>(value));
+    }
+    static void decode(const unsigned char *buffer, T &value) noexcept
+    {
+        UnderlyingType underlyingValue;
+        FieldCodec<UnderlyingType>::decode(buffer, underlyingValue);
+        value = static_cast<T>(underlyingValue);
+    }
+};
+
+template <typename Class, typename T, T Class::*member, typename Codec = FieldCodec<T>>
+struct Field final
+{
+    static constexpr std::size_t size = Codec::size;
+    static void encode(unsigned char *buffer, const Class &value) noexcept
+    {
+        Codec::encode(buffer, value.*member);
+    }
+    static void decode(const unsigned char *buffer, Class &value) noexcept
+    {
+        Codec::decode(buffer, value.*member);
+    }
+};
+
+#define schemaField(Class, member) \
+    ::programmerjake::voxels::io::Field<Class, decltype(Class::member), &Class::member>
+
+template <typename Class, typename... Fields>
+struct Schema;
+
+template <typename Class>
+struct Schema<Class>
+{
+    typedef Class ClassType;
+    static constexpr std::size_t size = 0;
+    static void encode(unsigned char *buffer, const Class &value) noexcept
+    {
+    }
+    static void decode(const unsigned char *buffer, Class &value) noexcept
+    {
+    }
+};
+
+template <typename Class, typename FirstField, typename... RestFields>
+struct Schema<Class, FirstField, RestFields...>
+{
+    typedef Class ClassType;
+    static constexpr std::size_t size = FirstField::size + Schema<Class, RestFields...>::size;
+    static void encode(unsigned char *buffer, const Class &value) noexcept
+    {
+        FirstField::encode(buffer, value);
+        Schema<Class, RestFields...>::encode(buffer + FirstField::size, value);
+    }
+    static void decode(const unsigned char *buffer, Class &value) noexcept
+    {
+        FirstField::decode(buffer, value);
+        Schema<Class, RestFields...>::decode(buffer + FirstField::size, value);
+    }
+};
+
+/** the bulk functions move records through a stack buffer of about this size */
+constexpr std::size_t schemaBulkBufferSize = 0x1000;
+
+/** @param reader an InputStream or one of the readers from reader.h */
+template <typename SchemaType, typename Reader>
+void readRecord(Reader &reader, typename SchemaType::ClassType &value)
+{
+    unsigned char buffer[SchemaType::size == 0 ? 1 : SchemaType::size];
+    reader.readAllBytes(buffer, SchemaType::size);
+    SchemaType::decode(buffer, value);
+}
+
+template <typename SchemaType, typename Reader>
+typename SchemaType::ClassType readRecord(Reader &reader)
+{
+    typename SchemaType::ClassType retval;
+    readRecord<SchemaType>(reader, retval);
+    return retval;
+}
+
+/** @param writer an OutputStream or anything else with writeBytes */
+template <typename SchemaType, typename Writer>
+void writeRecord(Writer &writer, const typename SchemaType::ClassType &value)
+{
+    unsigned char buffer[SchemaType::size == 0 ? 1 : SchemaType::size];
+    SchemaType::encode(buffer, value);
+    writer.writeBytes(buffer, SchemaType::size);
+}
+
+template <typename SchemaType, typename Reader>
+void readRecords(Reader &reader, typename SchemaType::ClassType *values, std::size_t count)
+{
+    constexpr std::size_t recordsPerChunk =
+        SchemaType::size >= schemaBulkBufferSize ?
+            1 :
+            schemaBulkBufferSize / (SchemaType::size == 0 ? 1 : SchemaType::size);
+    unsigned char buffer[SchemaType::size == 0 ? 1 : recordsPerChunk * SchemaType::size];
+    while(count > 0)
+    {
+        std::size_t chunkCount = count < recordsPerChunk ? count : recordsPerChunk;
+        reader.readAllBytes(buffer, chunkCount * SchemaType::size);
+        for(std::size_t i = 0; i < chunkCount; i++)
+            SchemaType::decode(buffer + i * SchemaType::size, values[i]);
+        values += chunkCount;
+        count -= chunkCount;
+    }
+}
+
+template <typename SchemaType, typename Writer>
+void writeRecords(Writer &writer, const typename SchemaType::ClassType *values, std::size_t count)
+{
+    constexpr std::size_t recordsPerChunk =
+        SchemaType::size >= schemaBulkBufferSize ?
+            1 :
+            schemaBulkBufferSize / (SchemaType::size == 0 ? 1 : SchemaType::size);
+    unsigned char buffer[SchemaType::size == 0 ? 1 : recordsPerChunk * SchemaType::size];
+    while(count > 0)
+    {
+        std::size_t chunkCount = count < recordsPerChunk ? count : recordsPerChunk;
+        for(std::size_t i = 0; i < chunkCount; i++)
+            SchemaType::encode(buffer + i * SchemaType::size, values[i]);
+        writer.writeBytes(buffer, chunkCount * SchemaType::size);
+        values += chunkCount;
+        count -= chunkCount;
+    }
+}
+}
+}
+}
+
+#endif /* IO_SCHEMA_H_ */
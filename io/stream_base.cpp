@@ -19,7 +19,7 @@
  *
  */
 #include "stream_base.h"
-#include <unordered_map>
+#include <vector>
 #include <atomic>
 
 namespace programmerjake
@@ -28,9 +28,16 @@ namespace voxels
 {
 namespace io
 {
+/** the keyed values that didn't fit inline, indexed by id since ids are allocated densely */
 struct StreamBase::KeyValueMapImplementation final
 {
-    std::unordered_map<std::size_t, std::shared_ptr<void>> map;
+    std::vector<std::shared_ptr<void>> values;
+    std::shared_ptr<void> *find(std::size_t id) noexcept
+    {
+        if(id >= values.size() || !values[id])
+            return nullptr;
+        return &values[id];
+    }
 };
 
 void StreamBase::freeKeyValueMap(KeyValueMapImplementation *keyValueMap) noexcept
@@ -40,19 +47,57 @@ void StreamBase::freeKeyValueMap(KeyValueMapImplementation *keyValueMap) noexcep
 
 std::shared_ptr<void> StreamBase::getKeyedValue(std::size_t id) const noexcept
 {
+    for(const KeyedValue &keyedValue : inlineKeyedValues)
+    {
+        if(keyedValue.id == id && keyedValue.value)
+            return keyedValue.value;
+    }
     if(!keyValueMap)
         return nullptr;
-    auto iter = keyValueMap->map.find(id);
-    if(iter == keyValueMap->map.end())
+    auto *value = keyValueMap->find(id);
+    if(!value)
         return nullptr;
-    return std::get<1>(*iter);
+    return *value;
 }
 
 void StreamBase::setKeyedValue(std::size_t id, std::shared_ptr<void> newValue)
 {
+    // an empty value marks an unused slot, so storing nullptr erases id
+    KeyedValue *freeSlot = nullptr;
+    for(KeyedValue &keyedValue : inlineKeyedValues)
+    {
+        if(!keyedValue.value)
+        {
+            if(!freeSlot)
+                freeSlot = &keyedValue;
+        }
+        else if(keyedValue.id == id)
+        {
+            keyedValue.value = std::move(newValue);
+            return;
+        }
+    }
+    if(keyValueMap)
+    {
+        if(auto *value = keyValueMap->find(id))
+        {
+            *value = std::move(newValue);
+            return;
+        }
+    }
+    if(!newValue)
+        return;
+    if(freeSlot)
+    {
+        freeSlot->id = id;
+        freeSlot->value = std::move(newValue);
+        return;
+    }
     if(!keyValueMap)
         keyValueMap = new KeyValueMapImplementation;
-    keyValueMap->map[id] = newValue;
+    if(id >= keyValueMap->values.size())
+        keyValueMap->values.resize(id + 1);
+    keyValueMap->values[id] = std::move(newValue);
 }
 
 std::size_t StreamBase::allocateKeyedValueId() noexcept
@@ -76,10 +76,36 @@ struct EOFError : public IOError
     }
 };
 
+struct ByteSpan final
+{
+    unsigned char *data;
+    std::size_t size;
+    constexpr ByteSpan(unsigned char *data, std::size_t size) : data(data), size(size)
+    {
+    }
+};
+
+struct ConstByteSpan final
+{
+    const unsigned char *data;
+    std::size_t size;
+    constexpr ConstByteSpan(const unsigned char *data, std::size_t size) : data(data), size(size)
+    {
+    }
+};
+
 class StreamBase : public std::enable_shared_from_this<StreamBase>
 {
 private:
     struct KeyValueMapImplementation;
+    struct KeyedValue final
+    {
+        std::size_t id = 0;
+        std::shared_ptr<void> value;
+    };
+    /** streams almost always carry no more than this many keyed values, so they're stored in the
+     * stream itself; any more go in keyValueMap */
+    static constexpr std::size_t inlineKeyedValueCount = 2;
     template <typename T, typename Tag>
     static std::size_t getKeyedValueId() noexcept
     {
@@ -92,8 +118,19 @@ private:
     std::shared_ptr<void> getKeyedValue(std::size_t id) const noexcept;
     void setKeyedValue(std::size_t id, std::shared_ptr<void> newValue);
     static std::size_t allocateKeyedValueId() noexcept;
+    void moveKeyedValuesFrom(StreamBase &rt) noexcept
+    {
+        for(std::size_t i = 0; i < inlineKeyedValueCount; i++)
+        {
+            inlineKeyedValues[i].id = rt.inlineKeyedValues[i].id;
+            inlineKeyedValues[i].value = std::move(rt.inlineKeyedValues[i].value);
+        }
+        keyValueMap = rt.keyValueMap;
+        rt.keyValueMap = nullptr;
+    }
 
 private:
+    KeyedValue inlineKeyedValues[inlineKeyedValueCount];
     KeyValueMapImplementation *keyValueMap = nullptr;
 
 public:
@@ -103,16 +140,15 @@ public:
             freeKeyValueMap(keyValueMap);
     }
     constexpr StreamBase() = default;
-    StreamBase(StreamBase &&rt) noexcept : keyValueMap(rt.keyValueMap)
+    StreamBase(StreamBase &&rt) noexcept
     {
-        rt.keyValueMap = nullptr;
+        moveKeyedValuesFrom(rt);
     }
     StreamBase &operator=(StreamBase rt) noexcept
     {
         if(keyValueMap)
             freeKeyValueMap(keyValueMap);
-        keyValueMap = rt.keyValueMap;
-        rt.keyValueMap = nullptr;
+        moveKeyedValuesFrom(rt);
         return *this;
     }
     template <typename T, typename Tag>
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#ifndef IO_TYPED_READER_H_
+#define IO_TYPED_READER_H_
+
+#include "stream_base.h"
+#include <cstdint>
+#include <type_traits>
+#include <limits>
+#include "../util/varint.h"
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace io
+{
+/** the typed read functions shared by InputStream and the statically dispatched readers.
+ * Derived must provide readAllBytes(unsigned char *buffer, std::size_t bufferSize) that fills
+ * buffer or throws EOFError. When Derived is a concrete type, everything inlines into the parser.
+ */
+template <typename Derived>
+struct TypedReader
+{
+private:
+    Derived &derived() noexcept
+    {
+        return static_cast<Derived &>(*this);
+    }
+
+public:
+    unsigned char readByte()
+    {
+        unsigned char retval;
+        derived().readAllBytes(&retval, 1);
+        return retval;
+    }
+    bool readBool()
+    {
+        return readByte() != 0;
+    }
+    static_assert(std::is_same<std::uint8_t, unsigned char>::value, "");
+    std::uint8_t readU8()
+    {
+        return readByte();
+    }
+    std::int8_t readS8()
+    {
+        return readU8();
+    }
+    std::uint16_t readU16()
+    {
+        const std::size_t byteCount = 2;
+        std::uint8_t bytes[byteCount];
+        derived().readAllBytes(bytes, byteCount);
+        return (static_cast<std::uint16_t>(bytes[1]) << 8) | bytes[0];
+    }
+    std::int16_t readS16()
+    {
+        return readU16();
+    }
+    std::uint32_t readU32()
+    {
+        const std::size_t byteCount = 4;
+        std::uint8_t bytes[byteCount];
+        derived().readAllBytes(bytes, byteCount);
+        return (static_cast<std::uint32_t>(bytes[3]) << 24)
+               | (static_cast<std::uint32_t>(bytes[2]) << 16)
+               | (static_cast<std::uint32_t>(bytes[1]) << 8) | bytes[0];
+    }
+    std::int32_t readS32()
+    {
+        return readU32();
+    }
+    std::uint64_t readU64()
+    {
+        const std::size_t byteCount = 8;
+        std::uint8_t bytes[byteCount];
+        derived().readAllBytes(bytes, byteCount);
+        return (static_cast<std::uint64_t>(bytes[7]) << 56)
+               | (static_cast<std::uint64_t>(bytes[6]) << 48)
+               | (static_cast<std::uint64_t>(bytes[5]) << 40)
+               | (static_cast<std::uint64_t>(bytes[4]) << 32)
+               | (static_cast<std::uint64_t>(bytes[3]) << 24)
+               | (static_cast<std::uint64_t>(bytes[2]) << 16)
+               | (static_cast<std::uint64_t>(bytes[1]) << 8) | bytes[0];
+    }
+    std::int64_t readS64()
+    {
+        return readU64();
+    }
+    float readF32()
+    {
+        static_assert(
+            std::numeric_limits<float>::is_iec559 && sizeof(float) == sizeof(std::uint32_t), "");
+        union
+        {
+            float f;
+            std::uint32_t i;
+        } u;
+        u.i = readU32();
+        return u.f;
+    }
+    double readF64()
+    {
+        static_assert(
+            std::numeric_limits<double>::is_iec559 && sizeof(double) == sizeof(std::uint64_t), "");
+        union
+        {
+            double f;
+            std::uint64_t i;
+        } u;
+        u.i = readU64();
+        return u.f;
+    }
+    std::uint64_t readVarU64()
+    {
+        std::uint64_t retval = 0;
+        for(std::size_t shift = 0;; shift += 7)
+        {
+            std::uint8_t byte = readByte();
+            if(shift == 63 && byte > 1)
+                throw IOError(std::make_error_code(std::errc::illegal_byte_sequence),
+                              "variable-length integer too big");
+            retval |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+            if((byte & 0x80) == 0)
+                return retval;
+        }
+    }
+    std::int64_t readVarS64()
+    {
+        return util::varint::zigZagDecode64(readVarU64());
+    }
+    std::uint32_t readVarU32()
+    {
+        std::uint32_t retval = 0;
+        for(std::size_t shift = 0;; shift += 7)
+        {
+            std::uint8_t byte = readByte();
+            if(shift == 28 && byte > 0xF)
+                throw IOError(std::make_error_code(std::errc::illegal_byte_sequence),
+                              "variable-length integer too big");
+            retval |= static_cast<std::uint32_t>(byte & 0x7F) << shift;
+            if((byte & 0x80) == 0)
+                return retval;
+        }
+    }
+    std::int32_t readVarS32()
+    {
+        return util::varint::zigZagDecode32(readVarU32());
+    }
+    /** reads count values written by OutputStream::writeVarU32Array */
+    void readVarU32Array(std::uint32_t *values, std::size_t count)
+    {
+        using namespace util::varint;
+        unsigned char buffer[getStreamVByteMaxEncodedSize(streamVByteBlockSize)];
+        while(count > 0)
+        {
+            std::size_t blockCount = count < streamVByteBlockSize ? count : streamVByteBlockSize;
+            std::size_t controlSize = getStreamVByteControlSize(blockCount);
+            derived().readAllBytes(buffer, controlSize);
+            std::size_t dataSize = getStreamVByteDataSize(buffer, blockCount);
+            derived().readAllBytes(buffer + controlSize, dataSize);
+            streamVByteDecode(buffer, controlSize + dataSize, values, blockCount);
+            values += blockCount;
+            count -= blockCount;
+        }
+    }
+};
+}
+}
+}
+
+#endif /* IO_TYPED_READER_H_ */
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#include "utf8_decoding_reader.h"
+#include "../util/constexpr_assert.h"
+#include <cstring>
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace io
+{
+namespace
+{
+/** the longest UTF-8 sequence */
+constexpr std::size_t maxSequenceSize = 4;
+
+/** @return false if there isn't room for ch */
+inline bool store(char32_t *output, std::size_t &used, std::size_t outputSize, char32_t ch)
+{
+    output[used++] = ch;
+    return true;
+}
+
+inline bool store(char16_t *output, std::size_t &used, std::size_t outputSize, char32_t ch)
+{
+    auto encoded = util::text::encodeUTF16(ch);
+    if(outputSize - used < encoded.size())
+        return false;
+    for(char16_t unit : encoded)
+        output[used++] = unit;
+    return true;
+}
+}
+
+UTF8DecodingReader::UTF8DecodingReader(std::shared_ptr<InputStream> stream,
+                                       const util::text::ConvertOptions &convertOptions,
+                                       std::size_t bufferSize)
+    : stream(std::move(stream)),
+      convertOptions(convertOptions),
+      buffer(),
+      bufferSize(bufferSize > maxSequenceSize ? bufferSize : maxSequenceSize),
+      current(0),
+      end(0),
+      streamHitEOF(false)
+{
+    buffer.reset(new unsigned char[this->bufferSize]);
+}
+
+void UTF8DecodingReader::fill()
+{
+    // keeps the start of a sequence that was split between reads
+    if(current > 0)
+    {
+        if(end > current)
+            std::memmove(buffer.get(), buffer.get() + current, end - current);
+        end -= current;
+        current = 0;
+    }
+    auto result = stream->readBytes(buffer.get() + end, bufferSize - end, nullptr);
+    end += result.readCount;
+    streamHitEOF = result.hitEOF;
+}
+
+template <typename CharType>
+std::size_t UTF8DecodingReader::readImplementation(CharType *output, std::size_t outputSize)
+{
+    std::size_t used = 0;
+    while(used < outputSize)
+    {
+        if(current == end)
+        {
+            if(streamHitEOF)
+                break;
+            fill();
+            continue;
+        }
+        std::size_t asciiCount = util::text::convertASCIIPrefix(
+            reinterpret_cast<const char *>(buffer.get() + current),
+            end - current < outputSize - used ? end - current : outputSize - used,
+            output + used);
+        current += asciiCount;
+        used += asciiCount;
+        if(current == end || used == outputSize)
+            continue;
+        if(end - current < maxSequenceSize && !streamHitEOF)
+        {
+            fill();
+            continue;
+        }
+        const char *iter = reinterpret_cast<const char *>(buffer.get() + current);
+        auto decoded =
+            util::text::decodeUTF8(iter,
+                                   reinterpret_cast<const char *>(buffer.get() + end),
+                                   convertOptions.allowUnpairedSurrogateCodePoints,
+                                   convertOptions.allow2ByteNull,
+                                   convertOptions.errorValue);
+        if(decoded > 0x10FFFFUL) // only an errorValue that isn't a code point can be out of range
+        {
+            if(used > 0)
+                break; // return what was decoded first; the next read reports the error
+            current = reinterpret_cast<const unsigned char *>(iter) - buffer.get();
+            throw IOError(std::make_error_code(std::errc::illegal_byte_sequence),
+                          "invalid UTF-8");
+        }
+        if(!store(output, used, outputSize, static_cast<char32_t>(decoded)))
+            break;
+        current = reinterpret_cast<const unsigned char *>(iter) - buffer.get();
+    }
+    return used;
+}
+
+std::size_t UTF8DecodingReader::read(char32_t *output, std::size_t outputSize)
+{
+    return readImplementation(output, outputSize);
+}
+
+std::size_t UTF8DecodingReader::read(char16_t *output, std::size_t outputSize)
+{
+    constexprAssert(outputSize >= 2);
+    return readImplementation(output, outputSize);
+}
+}
+}
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#ifndef IO_UTF8_DECODING_READER_H_
+#define IO_UTF8_DECODING_READER_H_
+
+#include "input_stream.h"
+#include "../util/text.h"
+#include <memory>
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace io
+{
+/** decodes a UTF-8 InputStream into blocks of UTF-32 or UTF-16. Runs of ASCII are converted many
+ * bytes at a time; everything else follows util::text::decodeUTF8. Sequences split between reads
+ * from the stream are decoded as if they weren't split.
+ */
+class UTF8DecodingReader final
+{
+    UTF8DecodingReader(const UTF8DecodingReader &) = delete;
+    UTF8DecodingReader &operator=(const UTF8DecodingReader &) = delete;
+
+public:
+    static constexpr std::size_t defaultBufferSize = 0x10000;
+
+private:
+    std::shared_ptr<InputStream> stream;
+    util::text::ConvertOptions convertOptions;
+    std::unique_ptr<unsigned char[]> buffer;
+    std::size_t bufferSize;
+    std::size_t current;
+    std::size_t end;
+    bool streamHitEOF;
+
+private:
+    void fill();
+    template <typename CharType>
+    std::size_t readImplementation(CharType *output, std::size_t outputSize);
+
+public:
+    /** invalid input decodes to convertOptions.errorValue. If that isn't a code point, like -1,
+     * read throws an IOError for the invalid bytes instead, after returning what came before them.
+     */
+    explicit UTF8DecodingReader(
+        std::shared_ptr<InputStream> stream,
+        const util::text::ConvertOptions &convertOptions = util::text::ConvertOptions(),
+        std::size_t bufferSize = defaultBufferSize);
+    /** decodes up to outputSize code points
+     * @return the number of code points decoded; less than outputSize only at the end
+     */
+    std::size_t read(char32_t *output, std::size_t outputSize);
+    /** decodes up to outputSize UTF-16 code units, never splitting a surrogate pair
+     * @param outputSize must be at least 2
+     * @return the number of code units decoded; 0 only at the end
+     */
+    std::size_t read(char16_t *output, std::size_t outputSize);
+};
+}
+}
+}
+
+#endif /* IO_UTF8_DECODING_READER_H_ */
@@ -27,7 +27,8 @@ int main()
     using namespace programmerjake::voxels;
     try
     {
-        auto inputStream = resource::ResourceManager().readResource("folder1/file1.txt");
+        static constexpr auto fileName = transcodeLiteral(char, "folder1/file1.txt");
+        auto inputStream = resource::ResourceManager().readResource(fileName);
         while(true)
         {
             constexpr std::size_t bufferSize = 256;
@@ -22,7 +22,12 @@
 #include <zip.h>
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include <mutex>
 #include "resource.h"
+#include "util/constexpr_assert.h"
 
 extern "C" {
 extern const unsigned char _binary_res_zip_start;
@@ -35,78 +40,190 @@ namespace voxels
 {
 namespace resource
 {
-struct ResourceManager::Implementation final : public io::InputStream
+namespace
 {
-    Implementation(const Implementation &) = delete;
-    Implementation &operator=(const Implementation &) = delete;
+zip_t *openResourceZip()
+{
+    zip_error_t zipError;
+    zip_error_init(&zipError);
+    auto source = zip_source_buffer_create(static_cast<const void *>(&_binary_res_zip_start),
+                                           &_binary_res_zip_end - &_binary_res_zip_start,
+                                           false,
+                                           &zipError);
+    if(!source)
+    {
+        std::cerr << "libzip error: zip_source_buffer_create: " << zip_error_strerror(&zipError)
+                  << std::endl;
+        zip_error_fini(&zipError);
+        abort();
+    }
+    zip_t *zip = zip_open_from_source(source, ZIP_RDONLY, &zipError);
+    if(!zip)
+    {
+        std::cerr << "libzip error: zip_open_from_source: " << zip_error_strerror(&zipError)
+                  << std::endl;
+        zip_source_free(source);
+        zip_error_fini(&zipError);
+        abort();
+    }
+    zip_error_fini(&zipError);
+    return zip;
+}
+
+/** the resource archive, opened once and shared by every resource stream, along with its names
+ * sorted by hash::FNV1a64, so lookups can skip hashing constant names. libzip isn't thread-safe
+ * within one archive, so hold getLock() while calling it.
+ */
+class ResourceIndex final
+{
+    ResourceIndex(const ResourceIndex &) = delete;
+    ResourceIndex &operator=(const ResourceIndex &) = delete;
 
 private:
-    struct ZipDeleter final
+    struct Entry final
     {
-        void operator()(zip_t *v) const noexcept
+        std::uint64_t hash;
+        zip_uint64_t index;
+        std::string name;
+        Entry(std::uint64_t hash, zip_uint64_t index, std::string name)
+            : hash(hash), index(index), name(std::move(name))
         {
-            zip_close(v);
+        }
+        bool operator<(const Entry &rt) const
+        {
+            return hash < rt.hash;
         }
     };
-    struct ZipFileDeleter final
+
+private:
+    zip_t *zip;
+    std::mutex lock;
+    std::vector<Entry> entries;
+
+private:
+    ResourceIndex() : zip(openResourceZip())
     {
-        void operator()(zip_file_t *v) const noexcept
+        zip_int64_t entryCount = zip_get_num_entries(zip, 0);
+        entries.reserve(entryCount > 0 ? entryCount : 0);
+        for(zip_int64_t index = 0; index < entryCount; index++)
         {
-            zip_fclose(v);
+            const char *name = zip_get_name(zip, index, ZIP_FL_ENC_STRICT);
+            if(!name)
+                continue;
+            std::size_t nameSize = std::strlen(name);
+            entries.emplace_back(
+                util::hash::FNV1a64::hash(name, nameSize), index, std::string(name, nameSize));
         }
-    };
+        std::stable_sort(entries.begin(), entries.end());
+    }
+
+public:
+    ~ResourceIndex()
+    {
+        zip_close(zip);
+    }
+    /** streams keep the returned pointer so the archive outlives them */
+    static std::shared_ptr<ResourceIndex> get()
+    {
+        static const std::shared_ptr<ResourceIndex> retval(new ResourceIndex);
+        return retval;
+    }
+    zip_t *getZip() const noexcept
+    {
+        return zip;
+    }
+    std::mutex &getLock() noexcept
+    {
+        return lock;
+    }
+    /** @return false if there's no resource named name */
+    bool find(const ResourceName &name, zip_uint64_t &index) const
+    {
+        auto iter = std::lower_bound(entries.begin(),
+                                     entries.end(),
+                                     name.getHash(),
+                                     [](const Entry &entry, std::uint64_t hash)
+                                     {
+                                         return entry.hash < hash;
+                                     });
+        for(; iter != entries.end() && iter->hash == name.getHash(); ++iter)
+        {
+            if(iter->name.size() == name.size()
+               && std::memcmp(iter->name.data(), name.data(), name.size()) == 0)
+            {
+                index = iter->index;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+}
+
+struct ResourceManager::Implementation final : public io::InputStream
+{
+    Implementation(const Implementation &) = delete;
+    Implementation &operator=(const Implementation &) = delete;
 
 private:
-    zip_t *zip = nullptr;
+    std::shared_ptr<ResourceIndex> archive;
+    zip_t *zip;
     zip_file_t *zipFile = nullptr;
+    zip_uint64_t fileIndex = 0;
+    std::uint64_t fileSize = 0;
+    std::uint64_t position = 0;
     unsigned char nextByte = 0;
     bool hasNextByte = false;
     bool hitEndOfFile = false;
 
-public:
-    explicit Implementation(const std::string &name)
-    {
-        zip_error_t zipError;
-        zip_error_init(&zipError);
-        auto source = zip_source_buffer_create(static_cast<const void *>(&_binary_res_zip_start),
-                                               &_binary_res_zip_end - &_binary_res_zip_start,
-                                               false,
-                                               &zipError);
-        if(!source)
+private:
+    /** call with archive->getLock() held */
+    void openFile()
+    {
+        zipFile = zip_fopen_index(zip, fileIndex, 0);
+        if(!zipFile)
         {
-            std::cerr << "libzip error: zip_source_buffer_create: " << zip_error_strerror(&zipError)
+            std::cerr << "libzip error: zip_fopen_index: " << zip_error_strerror(zip_get_error(zip))
                       << std::endl;
-            zip_error_fini(&zipError);
             abort();
         }
-        zip = zip_open_from_source(source, ZIP_RDONLY, &zipError);
-        if(!zip)
+        position = 0;
+        hasNextByte = false;
+        hitEndOfFile = false;
+    }
+    /** reads and discards count bytes */
+    void skip(std::uint64_t count)
+    {
+        unsigned char buffer[0x1000];
+        while(count > 0 && !hitEndOfFile)
         {
-            std::cerr << "libzip error: zip_open_from_source: " << zip_error_strerror(&zipError)
-                      << std::endl;
-            zip_source_free(source);
-            zip_error_fini(&zipError);
-            abort();
+            auto result =
+                readBytes(buffer, count < sizeof(buffer) ? count : sizeof(buffer), nullptr);
+            count -= result.readCount;
         }
-        zip_error_fini(&zipError);
-        zipFile = zip_fopen(zip, name.c_str(), ZIP_FL_ENC_STRICT);
-        if(!zipFile)
+    }
+
+public:
+    Implementation(std::shared_ptr<ResourceIndex> archiveIn, zip_uint64_t fileIndex)
+        : archive(std::move(archiveIn)), zip(archive->getZip()), fileIndex(fileIndex)
+    {
+        std::unique_lock<std::mutex> lockIt(archive->getLock());
+        zip_stat_t fileStat;
+        zip_stat_init(&fileStat);
+        if(zip_stat_index(zip, fileIndex, 0, &fileStat) != 0)
         {
-            if(zip_error_code_zip(zip_get_error(zip)) == ZIP_ER_NOENT)
-            {
-                zip_close(zip);
-                throw io::IOError(std::make_error_code(std::errc::no_such_file_or_directory), "file not found: " + name);
-            }
-            std::cerr << "libzip error: zip_fopen: " << zip_error_strerror(zip_get_error(zip))
+            std::cerr << "libzip error: zip_stat_index: " << zip_error_strerror(zip_get_error(zip))
                       << std::endl;
-            zip_close(zip);
             abort();
         }
+        constexprAssert(fileStat.valid & ZIP_STAT_SIZE);
+        fileSize = fileStat.size;
+        openFile();
     }
     virtual ~Implementation()
     {
+        std::unique_lock<std::mutex> lockIt(archive->getLock());
         zip_fclose(zipFile);
-        zip_close(zip);
     }
     virtual ReadBytesResult readBytes(unsigned char *buffer,
                                       std::size_t bufferSize,
@@ -121,7 +238,9 @@ public:
             bufferSize--;
             hasNextByte = false;
             totalReadCount++;
+            position++;
         }
+        std::unique_lock<std::mutex> lockIt(archive->getLock());
         if(bufferSize > 0 && !hitEndOfFile)
         {
             auto readCount = zip_fread(zipFile, static_cast<void *>(buffer), bufferSize);
@@ -137,6 +256,7 @@ public:
                 abort();
             }
             totalReadCount += readCount;
+            position += readCount;
         }
         auto readCount = zip_fread(zipFile, static_cast<void *>(&nextByte), 1);
         if(readCount < 0)
@@ -155,11 +275,49 @@ public:
         }
         return ReadBytesResult(totalReadCount, hitEndOfFile);
     }
+    virtual bool isSeekable() const noexcept override
+    {
+        return true;
+    }
+    /** zip entries are generally compressed, so seeking reads forward from the current position
+     * or, to go backward, from the start of the entry */
+    virtual void seek(std::uint64_t newPosition) override
+    {
+        if(newPosition > fileSize)
+            newPosition = fileSize;
+        if(newPosition < position)
+        {
+            std::unique_lock<std::mutex> lockIt(archive->getLock());
+            zip_fclose(zipFile);
+            zipFile = nullptr;
+            openFile();
+        }
+        skip(newPosition - position);
+    }
+    virtual std::uint64_t tell() override
+    {
+        return position;
+    }
+    virtual std::uint64_t size() override
+    {
+        return fileSize;
+    }
 };
 
 std::shared_ptr<io::InputStream> ResourceManager::readResource(const std::string &name)
 {
-    return std::make_shared<Implementation>(name);
+    return readResource(ResourceName(name));
+}
+
+std::shared_ptr<io::InputStream> ResourceManager::readResource(const ResourceName &name)
+{
+    auto archive = ResourceIndex::get();
+    zip_uint64_t fileIndex;
+    if(!archive->find(name, fileIndex))
+        throw io::IOError(std::make_error_code(std::errc::no_such_file_or_directory),
+                          "file not found: " + name.toString());
+    return std::allocate_shared<Implementation>(
+        util::PoolAllocator<Implementation>(), std::move(archive), fileIndex);
 }
 }
 }
@@ -23,7 +23,11 @@
 #define RESOURCE_H_
 
 #include "io/input_stream.h"
+#include "util/pool_allocator.h"
+#include "util/hash.h"
+#include "util/text.h"
 #include <memory>
+#include <string>
 
 namespace programmerjake
 {
@@ -31,6 +35,55 @@ namespace voxels
 {
 namespace resource
 {
+/** a resource name along with its hash::FNV1a64; doesn't own the name. Build it from a static
+ * constexpr transcodeLiteral(char, "...") to have the hash computed at compile time.
+ */
+class ResourceName final
+{
+private:
+    const char *name;
+    std::size_t nameSize;
+    std::uint64_t nameHash;
+
+public:
+    constexpr ResourceName(const char *name, std::size_t nameSize, std::uint64_t nameHash)
+        : name(name), nameSize(nameSize), nameHash(nameHash)
+    {
+    }
+    /** hashes name at runtime; name must outlive this, so don't keep one built from a
+     * temporary */
+    explicit ResourceName(const std::string &name)
+        : name(name.data()),
+          nameSize(name.size()),
+          nameHash(util::hash::FNV1a64::hash(name.data(), name.size()))
+    {
+    }
+    template <std::size_t N>
+    constexpr ResourceName(const util::text::TranscodedLiteral<char, N> &name)
+        : name(name.c_str()), nameSize(N), nameHash(name.utf8Hash)
+    {
+    }
+    /** the name would dangle once the temporary is destroyed */
+    template <std::size_t N>
+    ResourceName(const util::text::TranscodedLiteral<char, N> &&name) = delete;
+    constexpr const char *data() const
+    {
+        return name;
+    }
+    constexpr std::size_t size() const
+    {
+        return nameSize;
+    }
+    constexpr std::uint64_t getHash() const
+    {
+        return nameHash;
+    }
+    std::string toString() const
+    {
+        return std::string(name, nameSize);
+    }
+};
+
 class ResourceManager final
 {
     ResourceManager(const ResourceManager &) = delete;
@@ -41,7 +94,15 @@ private:
 
 public:
     ResourceManager() = default;
+    /** the returned stream is allocated from util::BlockPool */
     std::shared_ptr<io::InputStream> readResource(const std::string &name);
+    /** looks the name up by its hash, without hashing or comparing against every entry */
+    std::shared_ptr<io::InputStream> readResource(const ResourceName &name);
+    /** counts of the allocations made for resource streams, among others using the same pool */
+    static util::PoolStatistics getAllocationStatistics() noexcept
+    {
+        return util::BlockPool::getStatistics();
+    }
 };
 }
 }
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#include "byte_search.h"
+#include <cstdint>
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#define BYTE_SEARCH_USE_SSE2
+#include <emmintrin.h>
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__) && !defined(__ARM_BIG_ENDIAN)
+#define BYTE_SEARCH_USE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace util
+{
+namespace
+{
+const unsigned char *findFirstOfScalar(const unsigned char *begin,
+                                       const unsigned char *end,
+                                       const ByteSet &bytes) noexcept
+{
+    while(begin != end && !bytes.contains(*begin))
+        ++begin;
+    return begin;
+}
+
+/** fills all maxVectorSearchSize entries, repeating the first byte if the set is smaller */
+void getSearchBytes(const ByteSet &bytes,
+                    unsigned char (&searchBytes)[ByteSet::maxVectorSearchSize]) noexcept
+{
+    for(std::size_t i = 0; i < ByteSet::maxVectorSearchSize; i++)
+        searchBytes[i] = bytes.getBytes()[i < bytes.size() ? i : 0];
+}
+
+#ifdef BYTE_SEARCH_USE_SSE2
+const unsigned char *findFirstOfSSE2(const unsigned char *begin,
+                                     const unsigned char *end,
+                                     const ByteSet &bytes) noexcept
+{
+    unsigned char searchBytes[ByteSet::maxVectorSearchSize];
+    getSearchBytes(bytes, searchBytes);
+    const __m128i byte0 = _mm_set1_epi8(static_cast<char>(searchBytes[0]));
+    const __m128i byte1 = _mm_set1_epi8(static_cast<char>(searchBytes[1]));
+    const __m128i byte2 = _mm_set1_epi8(static_cast<char>(searchBytes[2]));
+    const __m128i byte3 = _mm_set1_epi8(static_cast<char>(searchBytes[3]));
+    while(end - begin >= 16)
+    {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+        __m128i matches = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, byte0), _mm_cmpeq_epi8(block, byte1)),
+            _mm_or_si128(_mm_cmpeq_epi8(block, byte2), _mm_cmpeq_epi8(block, byte3)));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(matches));
+        if(mask != 0)
+            return begin + __builtin_ctz(mask);
+        begin += 16;
+    }
+    return findFirstOfScalar(begin, end, bytes);
+}
+
+__attribute__((target("avx2"))) const unsigned char *findFirstOfAVX2(
+    const unsigned char *begin, const unsigned char *end, const ByteSet &bytes) noexcept
+{
+    unsigned char searchBytes[ByteSet::maxVectorSearchSize];
+    getSearchBytes(bytes, searchBytes);
+    const __m256i byte0 = _mm256_set1_epi8(static_cast<char>(searchBytes[0]));
+    const __m256i byte1 = _mm256_set1_epi8(static_cast<char>(searchBytes[1]));
+    const __m256i byte2 = _mm256_set1_epi8(static_cast<char>(searchBytes[2]));
+    const __m256i byte3 = _mm256_set1_epi8(static_cast<char>(searchBytes[3]));
+    while(end - begin >= 32)
+    {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin));
+        __m256i matches = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, byte0), _mm256_cmpeq_epi8(block, byte1)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, byte2), _mm256_cmpeq_epi8(block, byte3)));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(matches));
+        if(mask != 0)
+            return begin + __builtin_ctz(mask);
+        begin += 32;
+    }
+    return findFirstOfSSE2(begin, end, bytes);
+}
+
+bool hasAVX2() noexcept
+{
+    static const bool retval = __builtin_cpu_supports("avx2");
+    return retval;
+}
+#endif
+
+#ifdef BYTE_SEARCH_USE_NEON
+const unsigned char *findFirstOfNEON(const unsigned char *begin,
+                                     const unsigned char *end,
+                                     const ByteSet &bytes) noexcept
+{
+    unsigned char searchBytes[ByteSet::maxVectorSearchSize];
+    getSearchBytes(bytes, searchBytes);
+    const uint8x16_t byte0 = vdupq_n_u8(searchBytes[0]);
+    const uint8x16_t byte1 = vdupq_n_u8(searchBytes[1]);
+    const uint8x16_t byte2 = vdupq_n_u8(searchBytes[2]);
+    const uint8x16_t byte3 = vdupq_n_u8(searchBytes[3]);
+    while(end - begin >= 16)
+    {
+        uint8x16_t block = vld1q_u8(begin);
+        uint8x16_t matches = vorrq_u8(vorrq_u8(vceqq_u8(block, byte0), vceqq_u8(block, byte1)),
+                                      vorrq_u8(vceqq_u8(block, byte2), vceqq_u8(block, byte3)));
+        // narrow each byte to 4 bits so the whole mask fits in 64 bits
+        std::uint64_t mask = vget_lane_u64(
+            vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(matches), 4)), 0);
+        if(mask != 0)
+            return begin + __builtin_ctzll(mask) / 4;
+        begin += 16;
+    }
+    return findFirstOfScalar(begin, end, bytes);
+}
+#endif
+}
+
+const unsigned char *findFirstOf(const unsigned char *begin,
+                                 const unsigned char *end,
+                                 const ByteSet &bytes) noexcept
+{
+    if(bytes.size() == 1)
+        return findByte(begin, end, bytes.getBytes()[0]);
+    if(bytes.size() == 0)
+        return end;
+    if(bytes.size() > ByteSet::maxVectorSearchSize)
+        return findFirstOfScalar(begin, end, bytes);
+#if defined(BYTE_SEARCH_USE_SSE2)
+    if(hasAVX2())
+        return findFirstOfAVX2(begin, end, bytes);
+    return findFirstOfSSE2(begin, end, bytes);
+#elif defined(BYTE_SEARCH_USE_NEON)
+    return findFirstOfNEON(begin, end, bytes);
+#else
+    return findFirstOfScalar(begin, end, bytes);
+#endif
+}
+}
+}
+}
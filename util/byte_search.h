@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#ifndef UTIL_BYTE_SEARCH_H_
+#define UTIL_BYTE_SEARCH_H_
+
+#include <cstddef>
+#include <cstring>
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace util
+{
+/** a set of byte values to search for */
+class ByteSet final
+{
+public:
+    /** sets with at most this many bytes are searched with vector compares */
+    static constexpr std::size_t maxVectorSearchSize = 4;
+
+private:
+    bool contained[0x100];
+    unsigned char firstBytes[maxVectorSearchSize];
+    std::size_t byteCount;
+
+public:
+    ByteSet() noexcept : contained(), firstBytes(), byteCount(0)
+    {
+    }
+    /** @param bytes a nul-terminated list of the bytes in the set */
+    explicit ByteSet(const char *bytes) noexcept : ByteSet()
+    {
+        while(*bytes)
+            insert(static_cast<unsigned char>(*bytes++));
+    }
+    void insert(unsigned char byte) noexcept
+    {
+        if(contained[byte])
+            return;
+        contained[byte] = true;
+        if(byteCount < maxVectorSearchSize)
+            firstBytes[byteCount] = byte;
+        byteCount++;
+    }
+    bool contains(unsigned char byte) const noexcept
+    {
+        return contained[byte];
+    }
+    std::size_t size() const noexcept
+    {
+        return byteCount;
+    }
+    /** the bytes in the set, in insertion order; only valid if size() <= maxVectorSearchSize */
+    const unsigned char *getBytes() const noexcept
+    {
+        return firstBytes;
+    }
+};
+
+/** @return a pointer to the first byte equal to value, or end if there isn't one */
+inline const unsigned char *findByte(const unsigned char *begin,
+                                     const unsigned char *end,
+                                     unsigned char value) noexcept
+{
+    if(begin == end)
+        return end;
+    // the C library's memchr is already vectorized
+    const void *retval = std::memchr(begin, value, end - begin);
+    return retval ? static_cast<const unsigned char *>(retval) : end;
+}
+
+/** @return a pointer to the first byte in bytes, or end if there isn't one */
+const unsigned char *findFirstOf(const unsigned char *begin,
+                                 const unsigned char *end,
+                                 const ByteSet &bytes) noexcept;
+
+/** @return a pointer to the first byte not in bytes, or end if there isn't one */
+inline const unsigned char *findFirstNotOf(const unsigned char *begin,
+                                           const unsigned char *end,
+                                           const ByteSet &bytes) noexcept
+{
+    // runs of separators are short, so this isn't worth vectorizing
+    while(begin != end && bytes.contains(*begin))
+        ++begin;
+    return begin;
+}
+}
+}
+}
+
+#endif /* UTIL_BYTE_SEARCH_H_ */
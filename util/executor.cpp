@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#include "executor.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace util
+{
+struct ThreadPoolExecutor::Implementation final
+{
+    std::mutex lock;
+    std::condition_variable taskReadyCond;
+    std::deque<std::function<void()>> tasks;
+    bool done = false;
+    std::vector<std::thread> threads;
+    void threadFn()
+    {
+        std::unique_lock<std::mutex> lockIt(lock);
+        while(true)
+        {
+            while(tasks.empty() && !done)
+                taskReadyCond.wait(lockIt);
+            if(tasks.empty())
+                return;
+            std::function<void()> task = std::move(tasks.front());
+            tasks.pop_front();
+            lockIt.unlock();
+            task();
+            task = nullptr; // destroy captures without holding the lock
+            lockIt.lock();
+        }
+    }
+    explicit Implementation(std::size_t threadCount)
+    {
+        threads.reserve(threadCount);
+        try
+        {
+            for(std::size_t i = 0; i < threadCount; i++)
+                threads.emplace_back(&Implementation::threadFn, this);
+        }
+        catch(...)
+        {
+            stop();
+            throw;
+        }
+    }
+    void stop() noexcept
+    {
+        {
+            std::unique_lock<std::mutex> lockIt(lock);
+            done = true;
+            taskReadyCond.notify_all();
+        }
+        for(std::thread &thread : threads)
+            thread.join();
+        threads.clear();
+    }
+    ~Implementation()
+    {
+        stop();
+    }
+};
+
+ThreadPoolExecutor::ThreadPoolExecutor(std::size_t threadCount)
+{
+    if(threadCount == 0)
+        threadCount = std::thread::hardware_concurrency();
+    if(threadCount == 0)
+        threadCount = 1;
+    implementation = new Implementation(threadCount);
+}
+
+ThreadPoolExecutor::~ThreadPoolExecutor()
+{
+    delete implementation;
+}
+
+void ThreadPoolExecutor::execute(std::function<void()> task)
+{
+    std::unique_lock<std::mutex> lockIt(implementation->lock);
+    implementation->tasks.push_back(std::move(task));
+    implementation->taskReadyCond.notify_one();
+}
+
+ThreadPoolExecutor &ThreadPoolExecutor::getBlockingIOExecutor()
+{
+    // blocked threads don't use the CPU, so have more of them than there are hardware threads.
+    // Never destroyed: joining threads still blocked in reads would hang exit.
+    static ThreadPoolExecutor *retval =
+        new ThreadPoolExecutor(std::thread::hardware_concurrency() * 2 + 2);
+    return *retval;
+}
+}
+}
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#ifndef UTIL_EXECUTOR_H_
+#define UTIL_EXECUTOR_H_
+
+#include <functional>
+#include <cstddef>
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace util
+{
+/** runs tasks somewhere else: a thread pool, an event loop, ... */
+struct Executor
+{
+    virtual ~Executor() = default;
+    /** task must not throw */
+    virtual void execute(std::function<void()> task) = 0;
+};
+
+class ThreadPoolExecutor final : public Executor
+{
+    ThreadPoolExecutor(const ThreadPoolExecutor &) = delete;
+    ThreadPoolExecutor &operator=(const ThreadPoolExecutor &) = delete;
+
+private:
+    struct Implementation;
+
+private:
+    Implementation *implementation;
+
+public:
+    /** @param threadCount 0 means one thread per hardware thread */
+    explicit ThreadPoolExecutor(std::size_t threadCount = 0);
+    /** runs the tasks already queued, then stops the threads */
+    virtual ~ThreadPoolExecutor();
+    virtual void execute(std::function<void()> task) override;
+    /** a shared pool for running blocking reads and writes. It's never destroyed, so tasks still
+     * running at exit don't hold it up. */
+    static ThreadPoolExecutor &getBlockingIOExecutor();
+};
+}
+}
+}
+
+#endif /* UTIL_EXECUTOR_H_ */
@@ -0,0 +1,337 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#include "hash.h"
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HASH_USE_PCLMUL
+#include <wmmintrin.h>
+#include <smmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#define HASH_USE_ARM_CRC32
+#include <arm_acle.h>
+#endif
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace util
+{
+namespace hash
+{
+namespace
+{
+constexpr std::uint64_t xxHashPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr std::uint64_t xxHashPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr std::uint64_t xxHashPrime3 = 0x165667B19E3779F9ULL;
+constexpr std::uint64_t xxHashPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr std::uint64_t xxHashPrime5 = 0x27D4EB2F165667C5ULL;
+
+inline std::uint64_t rotateLeft(std::uint64_t value, int shift) noexcept
+{
+    return (value << shift) | (value >> (64 - shift));
+}
+
+inline std::uint32_t load32(const unsigned char *data) noexcept
+{
+    return static_cast<std::uint32_t>(data[0]) | static_cast<std::uint32_t>(data[1]) << 8
+           | static_cast<std::uint32_t>(data[2]) << 16 | static_cast<std::uint32_t>(data[3]) << 24;
+}
+
+inline std::uint64_t load64(const unsigned char *data) noexcept
+{
+    return static_cast<std::uint64_t>(load32(data))
+           | static_cast<std::uint64_t>(load32(data + 4)) << 32;
+}
+
+inline std::uint64_t xxHashRound(std::uint64_t accumulator, std::uint64_t input) noexcept
+{
+    accumulator += input * xxHashPrime2;
+    accumulator = rotateLeft(accumulator, 31);
+    return accumulator * xxHashPrime1;
+}
+
+inline std::uint64_t xxHashMergeRound(std::uint64_t accumulator, std::uint64_t value) noexcept
+{
+    accumulator ^= xxHashRound(0, value);
+    return accumulator * xxHashPrime1 + xxHashPrime4;
+}
+
+/** consumes whole 32-byte stripes
+ * @return the number of bytes consumed
+ */
+std::size_t xxHashStripes(std::uint64_t *accumulators,
+                          const unsigned char *data,
+                          std::size_t size) noexcept
+{
+    std::uint64_t v1 = accumulators[0], v2 = accumulators[1];
+    std::uint64_t v3 = accumulators[2], v4 = accumulators[3];
+    std::size_t retval = size - size % 32;
+    for(const unsigned char *end = data + retval; data != end; data += 32)
+    {
+        v1 = xxHashRound(v1, load64(data));
+        v2 = xxHashRound(v2, load64(data + 8));
+        v3 = xxHashRound(v3, load64(data + 16));
+        v4 = xxHashRound(v4, load64(data + 24));
+    }
+    accumulators[0] = v1;
+    accumulators[1] = v2;
+    accumulators[2] = v3;
+    accumulators[3] = v4;
+    return retval;
+}
+
+struct CRC32Tables final
+{
+    std::uint32_t tables[8][256];
+    CRC32Tables()
+    {
+        for(std::uint32_t i = 0; i < 256; i++)
+        {
+            std::uint32_t value = i;
+            for(int bit = 0; bit < 8; bit++)
+                value = value & 1 ? (value >> 1) ^ 0xEDB88320UL : value >> 1;
+            tables[0][i] = value;
+        }
+        for(std::size_t table = 1; table < 8; table++)
+        {
+            for(std::size_t i = 0; i < 256; i++)
+            {
+                std::uint32_t previous = tables[table - 1][i];
+                tables[table][i] = (previous >> 8) ^ tables[0][previous & 0xFF];
+            }
+        }
+    }
+    static const CRC32Tables &get()
+    {
+        static const CRC32Tables retval;
+        return retval;
+    }
+};
+
+/** slicing-by-8 */
+std::uint32_t crc32Scalar(std::uint32_t state, const unsigned char *data, std::size_t size) noexcept
+{
+    const auto &tables = CRC32Tables::get().tables;
+    while(size >= 8)
+    {
+        std::uint32_t low = load32(data) ^ state;
+        std::uint32_t high = load32(data + 4);
+        state = tables[7][low & 0xFF] ^ tables[6][(low >> 8) & 0xFF]
+                ^ tables[5][(low >> 16) & 0xFF] ^ tables[4][low >> 24] ^ tables[3][high & 0xFF]
+                ^ tables[2][(high >> 8) & 0xFF] ^ tables[1][(high >> 16) & 0xFF]
+                ^ tables[0][high >> 24];
+        data += 8;
+        size -= 8;
+    }
+    while(size-- > 0)
+        state = (state >> 8) ^ tables[0][(state ^ *data++) & 0xFF];
+    return state;
+}
+
+#ifdef HASH_USE_PCLMUL
+__attribute__((target("pclmul,sse4.1"))) inline __m128i crc32Fold16(__m128i value,
+                                                                    __m128i next,
+                                                                    __m128i constants) noexcept
+{
+    __m128i high = _mm_clmulepi64_si128(value, constants, 0x11);
+    value = _mm_clmulepi64_si128(value, constants, 0x00);
+    return _mm_xor_si128(_mm_xor_si128(value, high), next);
+}
+
+/** carry-less multiplication folding, as in Intel's "Fast CRC Computation for Generic Polynomials
+ * Using PCLMULQDQ Instruction"; handles size rounded down to a multiple of 16, which must be at
+ * least 64
+ * @return the new state
+ */
+__attribute__((target("pclmul,sse4.1"))) std::uint32_t crc32PCLMUL(std::uint32_t state,
+                                                                   const unsigned char *data,
+                                                                   std::size_t size) noexcept
+{
+    const __m128i k1k2 = _mm_set_epi64x(0x01C6E41596LL, 0x0154442BD4LL);
+    const __m128i k3k4 = _mm_set_epi64x(0x00CCAA009ELL, 0x01751997D0LL);
+    const __m128i k5 = _mm_set_epi64x(0, 0x0163CD6124LL);
+    const __m128i polynomialAndMu = _mm_set_epi64x(0x01F7011641LL, 0x01DB710641LL);
+    const __m128i mask32 = _mm_set_epi32(0, 0, 0, -1);
+    const __m128i *input = reinterpret_cast<const __m128i *>(data);
+    __m128i x1 = _mm_loadu_si128(input + 0);
+    __m128i x2 = _mm_loadu_si128(input + 1);
+    __m128i x3 = _mm_loadu_si128(input + 2);
+    __m128i x4 = _mm_loadu_si128(input + 3);
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(state)));
+    input += 4;
+    size -= 64;
+    for(; size >= 64; size -= 64, input += 4)
+    {
+        __m128i t1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        __m128i t2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        __m128i t3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        __m128i t4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+        x1 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        x2 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        x3 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        x4 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, t1), _mm_loadu_si128(input + 0));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, t2), _mm_loadu_si128(input + 1));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, t3), _mm_loadu_si128(input + 2));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, t4), _mm_loadu_si128(input + 3));
+    }
+    x1 = crc32Fold16(x1, x2, k3k4);
+    x1 = crc32Fold16(x1, x3, k3k4);
+    x1 = crc32Fold16(x1, x4, k3k4);
+    for(; size >= 16; size -= 16, input++)
+        x1 = crc32Fold16(x1, _mm_loadu_si128(input), k3k4);
+    // fold 128 bits to 64
+    __m128i t = _mm_clmulepi64_si128(k3k4, x1, 0x01);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), t);
+    // fold 64 bits to 32
+    t = _mm_srli_si128(x1, 4);
+    x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k5, 0x00);
+    x1 = _mm_xor_si128(x1, t);
+    // Barrett reduction
+    t = x1;
+    x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), polynomialAndMu, 0x10);
+    x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), polynomialAndMu, 0x00);
+    x1 = _mm_xor_si128(x1, t);
+    return static_cast<std::uint32_t>(_mm_extract_epi32(x1, 1));
+}
+
+bool hasPCLMUL() noexcept
+{
+    static const bool retval =
+        __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+    return retval;
+}
+#endif
+
+#ifdef HASH_USE_ARM_CRC32
+std::uint32_t crc32ARM(std::uint32_t state, const unsigned char *data, std::size_t size) noexcept
+{
+    for(; size >= 8; size -= 8, data += 8)
+        state = __crc32d(state, load64(data));
+    for(; size > 0; size--)
+        state = __crc32b(state, *data++);
+    return state;
+}
+#endif
+}
+
+void XXHash64::reset(std::uint64_t seed) noexcept
+{
+    this->seed = seed;
+    accumulators[0] = seed + xxHashPrime1 + xxHashPrime2;
+    accumulators[1] = seed + xxHashPrime2;
+    accumulators[2] = seed;
+    accumulators[3] = seed - xxHashPrime1;
+    totalSize = 0;
+    pendingSize = 0;
+}
+
+void XXHash64::update(const void *dataIn, std::size_t size) noexcept
+{
+    const unsigned char *data = static_cast<const unsigned char *>(dataIn);
+    totalSize += size;
+    if(pendingSize > 0)
+    {
+        std::size_t copySize = sizeof(pending) - pendingSize;
+        if(copySize > size)
+            copySize = size;
+        std::memcpy(pending + pendingSize, data, copySize);
+        pendingSize += copySize;
+        data += copySize;
+        size -= copySize;
+        if(pendingSize < sizeof(pending))
+            return;
+        xxHashStripes(accumulators, pending, sizeof(pending));
+        pendingSize = 0;
+    }
+    std::size_t usedSize = xxHashStripes(accumulators, data, size);
+    if(size > usedSize)
+    {
+        std::memcpy(pending, data + usedSize, size - usedSize);
+        pendingSize = size - usedSize;
+    }
+}
+
+std::uint64_t XXHash64::digest() const noexcept
+{
+    std::uint64_t retval;
+    if(totalSize >= 32)
+    {
+        retval = rotateLeft(accumulators[0], 1) + rotateLeft(accumulators[1], 7)
+                 + rotateLeft(accumulators[2], 12) + rotateLeft(accumulators[3], 18);
+        for(std::uint64_t accumulator : accumulators)
+            retval = xxHashMergeRound(retval, accumulator);
+    }
+    else
+    {
+        retval = seed + xxHashPrime5;
+    }
+    retval += totalSize;
+    const unsigned char *data = pending;
+    std::size_t size = pendingSize;
+    for(; size >= 8; size -= 8, data += 8)
+    {
+        retval ^= xxHashRound(0, load64(data));
+        retval = rotateLeft(retval, 27) * xxHashPrime1 + xxHashPrime4;
+    }
+    if(size >= 4)
+    {
+        retval ^= load32(data) * xxHashPrime1;
+        retval = rotateLeft(retval, 23) * xxHashPrime2 + xxHashPrime3;
+        size -= 4;
+        data += 4;
+    }
+    for(; size > 0; size--)
+    {
+        retval ^= *data++ * xxHashPrime5;
+        retval = rotateLeft(retval, 11) * xxHashPrime1;
+    }
+    retval ^= retval >> 33;
+    retval *= xxHashPrime2;
+    retval ^= retval >> 29;
+    retval *= xxHashPrime3;
+    retval ^= retval >> 32;
+    return retval;
+}
+
+void CRC32::update(const void *dataIn, std::size_t size) noexcept
+{
+    const unsigned char *data = static_cast<const unsigned char *>(dataIn);
+#if defined(HASH_USE_PCLMUL)
+    if(size >= 64 && hasPCLMUL())
+    {
+        std::size_t vectorSize = size - size % 16;
+        state = crc32PCLMUL(state, data, vectorSize);
+        data += vectorSize;
+        size -= vectorSize;
+    }
+#elif defined(HASH_USE_ARM_CRC32)
+    state = crc32ARM(state, data, size);
+    return;
+#endif
+    state = crc32Scalar(state, data, size);
+}
+}
+}
+}
+}
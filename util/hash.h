@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#ifndef UTIL_HASH_H_
+#define UTIL_HASH_H_
+
+#include <cstdint>
+#include <cstddef>
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace util
+{
+namespace hash
+{
+/** incremental XXH64; feeding the data in pieces gives the same digest as hashing it at once */
+class XXHash64 final
+{
+private:
+    std::uint64_t accumulators[4];
+    std::uint64_t seed;
+    std::uint64_t totalSize;
+    unsigned char pending[32];
+    std::size_t pendingSize;
+
+public:
+    explicit XXHash64(std::uint64_t seed = 0) noexcept
+    {
+        reset(seed);
+    }
+    void reset(std::uint64_t seed = 0) noexcept;
+    void update(const void *data, std::size_t size) noexcept;
+    /** @return the hash of everything passed to update so far */
+    std::uint64_t digest() const noexcept;
+    static std::uint64_t hash(const void *data, std::size_t size, std::uint64_t seed = 0) noexcept
+    {
+        XXHash64 hasher(seed);
+        hasher.update(data, size);
+        return hasher.digest();
+    }
+};
+
+/** 64-bit FNV-1a. Much weaker than XXHash64, but simple enough to evaluate in constant
+ * expressions, so names known at compile time can be hashed at compile time
+ */
+class FNV1a64 final
+{
+public:
+    static constexpr std::uint64_t offsetBasis = 0xCBF29CE484222325ULL;
+    static constexpr std::uint64_t prime = 0x100000001B3ULL;
+    static constexpr std::uint64_t update(std::uint64_t state, unsigned char byte) noexcept
+    {
+        return (state ^ byte) * prime;
+    }
+    static std::uint64_t hash(const void *data, std::size_t size) noexcept
+    {
+        const unsigned char *bytes = static_cast<const unsigned char *>(data);
+        std::uint64_t state = offsetBasis;
+        for(std::size_t i = 0; i < size; i++)
+            state = update(state, bytes[i]);
+        return state;
+    }
+};
+
+/** incremental CRC-32 (the zlib/PNG/gzip polynomial), using PCLMULQDQ or the ARMv8 CRC
+ * instructions when available
+ */
+class CRC32 final
+{
+private:
+    std::uint32_t state;
+
+public:
+    explicit CRC32(std::uint32_t initialCRC = 0) noexcept : state(~initialCRC)
+    {
+    }
+    /** @param initialCRC the CRC of the data preceding what will be passed to update */
+    void reset(std::uint32_t initialCRC = 0) noexcept
+    {
+        state = ~initialCRC;
+    }
+    void update(const void *data, std::size_t size) noexcept;
+    std::uint32_t digest() const noexcept
+    {
+        return ~state;
+    }
+    static std::uint32_t hash(const void *data, std::size_t size) noexcept
+    {
+        CRC32 hasher;
+        hasher.update(data, size);
+        return hasher.digest();
+    }
+};
+}
+}
+}
+}
+
+#endif /* UTIL_HASH_H_ */
@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#include "pool_allocator.h"
+#include <atomic>
+#include <mutex>
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace util
+{
+namespace
+{
+constexpr std::size_t sizeClassCount = BlockPool::maxPooledSize / BlockPool::sizeGranularity;
+
+struct FreeBlock final
+{
+    FreeBlock *next;
+};
+
+/** a counter only its own thread writes to, so incrementing it needs no locked instruction */
+struct ThreadCounter final
+{
+    std::atomic<std::uint64_t> value;
+    ThreadCounter() : value(0)
+    {
+    }
+    void increment() noexcept
+    {
+        value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    std::uint64_t get() const noexcept
+    {
+        return value.load(std::memory_order_relaxed);
+    }
+};
+
+struct ThreadCache final
+{
+    FreeBlock *freeLists[sizeClassCount] = {};
+    std::size_t freeCounts[sizeClassCount] = {};
+    ThreadCounter allocationCount;
+    ThreadCounter recycledCount;
+    ThreadCounter deallocationCount;
+    ThreadCache *previous = nullptr;
+    ThreadCache *next = nullptr;
+    ~ThreadCache()
+    {
+        for(FreeBlock *&freeList : freeLists)
+        {
+            while(freeList)
+            {
+                FreeBlock *block = freeList;
+                freeList = block->next;
+                ::operator delete(block);
+            }
+        }
+    }
+};
+
+/** all live thread caches, for getStatistics, and the totals of the threads that have exited */
+struct Registry final
+{
+    std::mutex lock;
+    ThreadCache *head = nullptr;
+    std::atomic<std::uint64_t> allocationCount;
+    std::atomic<std::uint64_t> recycledCount;
+    std::atomic<std::uint64_t> deallocationCount;
+    Registry() : allocationCount(0), recycledCount(0), deallocationCount(0)
+    {
+    }
+    static Registry &get()
+    {
+        // never destroyed, since blocks can be freed during static destruction
+        static Registry *retval = new Registry;
+        return *retval;
+    }
+};
+
+// these two are trivially destructible, so they stay usable while the thread is exiting
+thread_local ThreadCache *currentThreadCache = nullptr;
+thread_local bool threadCacheDestroyed = false;
+
+struct ThreadCacheOwner final
+{
+    ~ThreadCacheOwner()
+    {
+        threadCacheDestroyed = true;
+        ThreadCache *cache = currentThreadCache;
+        if(!cache)
+            return;
+        currentThreadCache = nullptr;
+        Registry &registry = Registry::get();
+        {
+            std::unique_lock<std::mutex> lockIt(registry.lock);
+            registry.allocationCount.fetch_add(cache->allocationCount.get(),
+                                               std::memory_order_relaxed);
+            registry.recycledCount.fetch_add(cache->recycledCount.get(),
+                                             std::memory_order_relaxed);
+            registry.deallocationCount.fetch_add(cache->deallocationCount.get(),
+                                                 std::memory_order_relaxed);
+            if(cache->previous)
+                cache->previous->next = cache->next;
+            else
+                registry.head = cache->next;
+            if(cache->next)
+                cache->next->previous = cache->previous;
+        }
+        delete cache;
+    }
+};
+
+thread_local ThreadCacheOwner threadCacheOwner;
+
+ThreadCache *createThreadCache()
+{
+    static_cast<void>(&threadCacheOwner); // makes sure the owner is constructed
+    ThreadCache *cache = new(std::nothrow) ThreadCache;
+    if(!cache)
+        return nullptr;
+    Registry &registry = Registry::get();
+    std::unique_lock<std::mutex> lockIt(registry.lock);
+    cache->next = registry.head;
+    if(registry.head)
+        registry.head->previous = cache;
+    registry.head = cache;
+    currentThreadCache = cache;
+    return cache;
+}
+
+/** @return nullptr if this thread is exiting */
+inline ThreadCache *getThreadCache() noexcept
+{
+    ThreadCache *retval = currentThreadCache;
+    if(retval || threadCacheDestroyed)
+        return retval;
+    try
+    {
+        return createThreadCache();
+    }
+    catch(...)
+    {
+        return nullptr;
+    }
+}
+
+/** @return the size class for size, or sizeClassCount if it isn't pooled */
+inline std::size_t getSizeClass(std::size_t size) noexcept
+{
+    if(size == 0)
+        size = 1;
+    if(size > BlockPool::maxPooledSize)
+        return sizeClassCount;
+    return (size - 1) / BlockPool::sizeGranularity;
+}
+}
+
+void *BlockPool::allocate(std::size_t size)
+{
+    ThreadCache *cache = getThreadCache();
+    if(cache)
+        cache->allocationCount.increment();
+    else
+        Registry::get().allocationCount.fetch_add(1, std::memory_order_relaxed);
+    std::size_t sizeClass = getSizeClass(size);
+    if(sizeClass == sizeClassCount)
+        return ::operator new(size);
+    if(cache)
+    {
+        if(FreeBlock *block = cache->freeLists[sizeClass])
+        {
+            cache->freeLists[sizeClass] = block->next;
+            cache->freeCounts[sizeClass]--;
+            cache->recycledCount.increment();
+            return block;
+        }
+    }
+    return ::operator new((sizeClass + 1) * sizeGranularity);
+}
+
+void BlockPool::deallocate(void *block, std::size_t size) noexcept
+{
+    if(!block)
+        return;
+    ThreadCache *cache = getThreadCache();
+    if(!cache)
+    {
+        Registry::get().deallocationCount.fetch_add(1, std::memory_order_relaxed);
+        ::operator delete(block);
+        return;
+    }
+    cache->deallocationCount.increment();
+    std::size_t sizeClass = getSizeClass(size);
+    if(sizeClass != sizeClassCount && cache->freeCounts[sizeClass] < maxFreeBlocksPerSize)
+    {
+        FreeBlock *freeBlock = static_cast<FreeBlock *>(block);
+        freeBlock->next = cache->freeLists[sizeClass];
+        cache->freeLists[sizeClass] = freeBlock;
+        cache->freeCounts[sizeClass]++;
+        return;
+    }
+    ::operator delete(block);
+}
+
+PoolStatistics BlockPool::getStatistics() noexcept
+{
+    Registry &registry = Registry::get();
+    std::unique_lock<std::mutex> lockIt(registry.lock);
+    PoolStatistics retval;
+    retval.allocationCount = registry.allocationCount.load(std::memory_order_relaxed);
+    retval.recycledCount = registry.recycledCount.load(std::memory_order_relaxed);
+    std::uint64_t deallocationCount = registry.deallocationCount.load(std::memory_order_relaxed);
+    for(ThreadCache *cache = registry.head; cache; cache = cache->next)
+    {
+        retval.allocationCount += cache->allocationCount.get();
+        retval.recycledCount += cache->recycledCount.get();
+        deallocationCount += cache->deallocationCount.get();
+    }
+    retval.liveCount = retval.allocationCount - deallocationCount;
+    return retval;
+}
+}
+}
+}
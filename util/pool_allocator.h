@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#ifndef UTIL_POOL_ALLOCATOR_H_
+#define UTIL_POOL_ALLOCATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace util
+{
+struct PoolStatistics final
+{
+    /** blocks handed out */
+    std::uint64_t allocationCount = 0;
+    /** blocks handed out that were reused instead of coming from the global allocator */
+    std::uint64_t recycledCount = 0;
+    /** blocks handed out and not yet returned */
+    std::uint64_t liveCount = 0;
+};
+
+/** recycles freed blocks through per-thread free lists, one per size class, so allocating and
+ * freeing short-lived objects of the same sizes doesn't touch the global allocator or take locks.
+ * Blocks may be freed on any thread; each thread keeps a bounded number of free blocks.
+ */
+class BlockPool final
+{
+public:
+    static constexpr std::size_t sizeGranularity = 64;
+    static constexpr std::size_t maxPooledSize = 0x1000;
+    static constexpr std::size_t maxFreeBlocksPerSize = 64;
+
+public:
+    BlockPool() = delete;
+    static void *allocate(std::size_t size);
+    /** @param size the size passed to allocate */
+    static void deallocate(void *block, std::size_t size) noexcept;
+    static PoolStatistics getStatistics() noexcept;
+};
+
+/** an allocator for std::allocate_shared and the containers that takes memory from BlockPool */
+template <typename T>
+struct PoolAllocator
+{
+    typedef T value_type;
+    PoolAllocator() noexcept = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U> &) noexcept
+    {
+    }
+    T *allocate(std::size_t count)
+    {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned types not supported");
+        if(count > static_cast<std::size_t>(-1) / sizeof(T))
+            throw std::bad_alloc();
+        return static_cast<T *>(BlockPool::allocate(count * sizeof(T)));
+    }
+    void deallocate(T *block, std::size_t count) noexcept
+    {
+        BlockPool::deallocate(block, count * sizeof(T));
+    }
+    template <typename U>
+    struct rebind
+    {
+        typedef PoolAllocator<U> other;
+    };
+    template <typename U>
+    bool operator==(const PoolAllocator<U> &) const noexcept
+    {
+        return true;
+    }
+    template <typename U>
+    bool operator!=(const PoolAllocator<U> &) const noexcept
+    {
+        return false;
+    }
+};
+}
+}
+}
+
+#endif /* UTIL_POOL_ALLOCATOR_H_ */
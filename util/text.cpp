@@ -0,0 +1,601 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#include "text.h"
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#define TEXT_USE_SSE2
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__) && !defined(__ARM_BIG_ENDIAN)
+#define TEXT_USE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace util
+{
+namespace text
+{
+namespace
+{
+constexpr std::uint64_t highBitsMask = 0x8080808080808080ULL;
+
+template <typename CharType>
+inline bool isASCII(CharType ch) noexcept
+{
+    typedef typename std::make_unsigned<CharType>::type UnsignedType;
+    return static_cast<UnsignedType>(ch) < 0x80;
+}
+
+template <typename SourceCharType>
+std::size_t getASCIIPrefixLengthScalar(const SourceCharType *source, std::size_t size) noexcept
+{
+    std::size_t index = 0;
+    while(index < size && isASCII(source[index]))
+        index++;
+    return index;
+}
+
+template <>
+std::size_t getASCIIPrefixLengthScalar(const char *source, std::size_t size) noexcept
+{
+    std::size_t index = 0;
+    while(size - index >= 8)
+    {
+        std::uint64_t word;
+        std::memcpy(&word, source + index, sizeof(word));
+        if(word & highBitsMask)
+            break;
+        index += 8;
+    }
+    while(index < size && isASCII(source[index]))
+        index++;
+    return index;
+}
+
+template <typename SourceCharType, typename TargetCharType>
+std::size_t convertASCIIPrefixScalar(const SourceCharType *source,
+                                     std::size_t size,
+                                     TargetCharType *destination) noexcept
+{
+    std::size_t retval = getASCIIPrefixLengthScalar(source, size);
+    for(std::size_t i = 0; i < retval; i++)
+    {
+        typedef typename std::make_unsigned<SourceCharType>::type UnsignedType;
+        destination[i] = static_cast<TargetCharType>(static_cast<UnsignedType>(source[i]));
+    }
+    return retval;
+}
+
+#if defined(TEXT_USE_SSE2)
+/** the number of source characters the vector kernels handle at once */
+constexpr std::size_t blockSize = 16;
+
+inline __m128i load(const void *source) noexcept
+{
+    return _mm_loadu_si128(static_cast<const __m128i *>(source));
+}
+
+inline void store(void *destination, __m128i value) noexcept
+{
+    _mm_storeu_si128(static_cast<__m128i *>(destination), value);
+}
+
+inline bool isBlockASCII(const char *source) noexcept
+{
+    return _mm_movemask_epi8(load(source)) == 0;
+}
+
+inline bool isBlockASCII(const char16_t *source) noexcept
+{
+    __m128i combined = _mm_or_si128(load(source), load(source + 8));
+    __m128i nonASCIIBits = _mm_and_si128(combined, _mm_set1_epi16(static_cast<short>(0xFF80)));
+    return _mm_movemask_epi8(_mm_cmpeq_epi16(nonASCIIBits, _mm_setzero_si128())) == 0xFFFF;
+}
+
+inline bool isBlockASCII(const char32_t *source) noexcept
+{
+    __m128i combined = _mm_or_si128(_mm_or_si128(load(source), load(source + 4)),
+                                    _mm_or_si128(load(source + 8), load(source + 12)));
+    __m128i nonASCIIBits = _mm_and_si128(combined, _mm_set1_epi32(~0x7F));
+    return _mm_movemask_epi8(_mm_cmpeq_epi32(nonASCIIBits, _mm_setzero_si128())) == 0xFFFF;
+}
+
+inline void convertBlock(const char *source, char16_t *destination) noexcept
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i bytes = load(source);
+    store(destination, _mm_unpacklo_epi8(bytes, zero));
+    store(destination + 8, _mm_unpackhi_epi8(bytes, zero));
+}
+
+inline void convertBlock(const char *source, char32_t *destination) noexcept
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i bytes = load(source);
+    __m128i low = _mm_unpacklo_epi8(bytes, zero);
+    __m128i high = _mm_unpackhi_epi8(bytes, zero);
+    store(destination, _mm_unpacklo_epi16(low, zero));
+    store(destination + 4, _mm_unpackhi_epi16(low, zero));
+    store(destination + 8, _mm_unpacklo_epi16(high, zero));
+    store(destination + 12, _mm_unpackhi_epi16(high, zero));
+}
+
+inline void convertBlock(const char16_t *source, char *destination) noexcept
+{
+    store(destination, _mm_packus_epi16(load(source), load(source + 8)));
+}
+
+inline void convertBlock(const char32_t *source, char *destination) noexcept
+{
+    // the values are all less than 0x80, so the saturating packs don't change them
+    __m128i low = _mm_packs_epi32(load(source), load(source + 4));
+    __m128i high = _mm_packs_epi32(load(source + 8), load(source + 12));
+    store(destination, _mm_packus_epi16(low, high));
+}
+#elif defined(TEXT_USE_NEON)
+constexpr std::size_t blockSize = 16;
+
+inline bool isBlockASCII(const char *source) noexcept
+{
+    return vmaxvq_u8(vld1q_u8(reinterpret_cast<const std::uint8_t *>(source))) < 0x80;
+}
+
+inline bool isBlockASCII(const char16_t *source) noexcept
+{
+    const std::uint16_t *input = reinterpret_cast<const std::uint16_t *>(source);
+    return vmaxvq_u16(vorrq_u16(vld1q_u16(input), vld1q_u16(input + 8))) < 0x80;
+}
+
+inline bool isBlockASCII(const char32_t *source) noexcept
+{
+    const std::uint32_t *input = reinterpret_cast<const std::uint32_t *>(source);
+    uint32x4_t combined = vorrq_u32(vorrq_u32(vld1q_u32(input), vld1q_u32(input + 4)),
+                                    vorrq_u32(vld1q_u32(input + 8), vld1q_u32(input + 12)));
+    return vmaxvq_u32(combined) < 0x80;
+}
+
+inline void convertBlock(const char *source, char16_t *destination) noexcept
+{
+    uint8x16_t bytes = vld1q_u8(reinterpret_cast<const std::uint8_t *>(source));
+    std::uint16_t *output = reinterpret_cast<std::uint16_t *>(destination);
+    vst1q_u16(output, vmovl_u8(vget_low_u8(bytes)));
+    vst1q_u16(output + 8, vmovl_u8(vget_high_u8(bytes)));
+}
+
+inline void convertBlock(const char *source, char32_t *destination) noexcept
+{
+    uint8x16_t bytes = vld1q_u8(reinterpret_cast<const std::uint8_t *>(source));
+    uint16x8_t low = vmovl_u8(vget_low_u8(bytes));
+    uint16x8_t high = vmovl_u8(vget_high_u8(bytes));
+    std::uint32_t *output = reinterpret_cast<std::uint32_t *>(destination);
+    vst1q_u32(output, vmovl_u16(vget_low_u16(low)));
+    vst1q_u32(output + 4, vmovl_u16(vget_high_u16(low)));
+    vst1q_u32(output + 8, vmovl_u16(vget_low_u16(high)));
+    vst1q_u32(output + 12, vmovl_u16(vget_high_u16(high)));
+}
+
+inline void convertBlock(const char16_t *source, char *destination) noexcept
+{
+    const std::uint16_t *input = reinterpret_cast<const std::uint16_t *>(source);
+    vst1q_u8(reinterpret_cast<std::uint8_t *>(destination),
+             vcombine_u8(vmovn_u16(vld1q_u16(input)), vmovn_u16(vld1q_u16(input + 8))));
+}
+
+inline void convertBlock(const char32_t *source, char *destination) noexcept
+{
+    const std::uint32_t *input = reinterpret_cast<const std::uint32_t *>(source);
+    uint16x8_t low = vcombine_u16(vmovn_u32(vld1q_u32(input)), vmovn_u32(vld1q_u32(input + 4)));
+    uint16x8_t high =
+        vcombine_u16(vmovn_u32(vld1q_u32(input + 8)), vmovn_u32(vld1q_u32(input + 12)));
+    vst1q_u8(reinterpret_cast<std::uint8_t *>(destination),
+             vcombine_u8(vmovn_u16(low), vmovn_u16(high)));
+}
+#endif
+
+#if defined(TEXT_USE_SSE2) || defined(TEXT_USE_NEON)
+template <typename SourceCharType>
+std::size_t getASCIIPrefixLengthVector(const SourceCharType *source, std::size_t size) noexcept
+{
+    std::size_t index = 0;
+    while(size - index >= blockSize && isBlockASCII(source + index))
+        index += blockSize;
+    return index + getASCIIPrefixLengthScalar(source + index, size - index);
+}
+
+template <typename SourceCharType, typename TargetCharType>
+std::size_t convertASCIIPrefixVector(const SourceCharType *source,
+                                     std::size_t size,
+                                     TargetCharType *destination) noexcept
+{
+    std::size_t index = 0;
+    while(size - index >= blockSize && isBlockASCII(source + index))
+    {
+        convertBlock(source + index, destination + index);
+        index += blockSize;
+    }
+    return index
+           + convertASCIIPrefixScalar(source + index, size - index, destination + index);
+}
+#else
+template <typename SourceCharType>
+std::size_t getASCIIPrefixLengthVector(const SourceCharType *source, std::size_t size) noexcept
+{
+    return getASCIIPrefixLengthScalar(source, size);
+}
+
+template <typename SourceCharType, typename TargetCharType>
+std::size_t convertASCIIPrefixVector(const SourceCharType *source,
+                                     std::size_t size,
+                                     TargetCharType *destination) noexcept
+{
+    return convertASCIIPrefixScalar(source, size, destination);
+}
+#endif
+}
+
+std::size_t convertASCIIPrefix(const char *source,
+                               std::size_t size,
+                               char16_t *destination) noexcept
+{
+    return convertASCIIPrefixVector(source, size, destination);
+}
+
+std::size_t convertASCIIPrefix(const char *source,
+                               std::size_t size,
+                               char32_t *destination) noexcept
+{
+    return convertASCIIPrefixVector(source, size, destination);
+}
+
+std::size_t convertASCIIPrefix(const char16_t *source,
+                               std::size_t size,
+                               char *destination) noexcept
+{
+    return convertASCIIPrefixVector(source, size, destination);
+}
+
+std::size_t convertASCIIPrefix(const char32_t *source,
+                               std::size_t size,
+                               char *destination) noexcept
+{
+    return convertASCIIPrefixVector(source, size, destination);
+}
+
+std::size_t getASCIIPrefixLength(const char *source, std::size_t size) noexcept
+{
+    return getASCIIPrefixLengthVector(source, size);
+}
+
+std::size_t getASCIIPrefixLength(const char16_t *source, std::size_t size) noexcept
+{
+    return getASCIIPrefixLengthVector(source, size);
+}
+
+std::size_t getASCIIPrefixLength(const char32_t *source, std::size_t size) noexcept
+{
+    return getASCIIPrefixLengthVector(source, size);
+}
+
+std::size_t getASCIIPrefixLength(const wchar_t *source, std::size_t size) noexcept
+{
+    return getASCIIPrefixLengthScalar(source, size);
+}
+
+namespace
+{
+/** decodeUTF8 never returns this */
+constexpr std::char_traits<char32_t>::int_type invalidCodePoint = 0xFFFFFFFFUL;
+
+/** validates the sequences starting at position until reaching stopPosition or the end, leaving
+ * position after the last sequence checked
+ * @return false if a sequence is invalid, with position at its start
+ */
+bool validateUTF8Scalar(const char *begin,
+                        const char *end,
+                        std::size_t &position,
+                        std::size_t stopPosition,
+                        const ConvertOptions &convertOptions) noexcept
+{
+    std::size_t size = end - begin;
+    while(position < stopPosition && position < size)
+    {
+        position += getASCIIPrefixLength(begin + position, stopPosition - position);
+        if(position >= stopPosition)
+            break;
+        const char *iter = begin + position;
+        if(decodeUTF8(iter,
+                      end,
+                      convertOptions.allowUnpairedSurrogateCodePoints,
+                      convertOptions.allow2ByteNull,
+                      invalidCodePoint) == invalidCodePoint)
+            return false;
+        position = iter - begin;
+    }
+    return true;
+}
+
+/** @return the start of the sequence that position is in, given that everything before the
+ * sequence is valid */
+std::size_t findSequenceStart(const char *begin, std::size_t position) noexcept
+{
+    for(std::size_t i = 1; i <= 3 && i <= position; i++)
+    {
+        auto byte = static_cast<unsigned char>(begin[position - i]);
+        if(byte < 0x80)
+            break;
+        if(byte >= 0xC0)
+        {
+            std::size_t sequenceLength = byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : 2;
+            if(sequenceLength > i)
+                return position - i;
+            break;
+        }
+    }
+    return position;
+}
+
+/* The vector validator is the lookup-table algorithm from "Validating UTF-8 In Less Than One
+ * Instruction Per Byte" by John Keiser and Daniel Lemire. Each pair of adjacent bytes is
+ * classified by three 16-entry tables, one indexed by each nibble of the first byte and one by
+ * the high nibble of the second; an error bit survives the and of all three only for an invalid
+ * pair. Blocks the tables reject are rechecked by validateUTF8Scalar, which applies
+ * allow2ByteNull and finds the exact offset.
+ */
+constexpr std::uint8_t tooShort = 1 << 0;
+constexpr std::uint8_t tooLong = 1 << 1;
+constexpr std::uint8_t overlong3 = 1 << 2;
+constexpr std::uint8_t tooLarge = 1 << 3;
+constexpr std::uint8_t surrogate = 1 << 4;
+constexpr std::uint8_t overlong2 = 1 << 5;
+constexpr std::uint8_t tooLarge1000 = 1 << 6;
+constexpr std::uint8_t overlong4 = 1 << 6;
+constexpr std::uint8_t twoContinuations = 1 << 7;
+constexpr std::uint8_t carry = tooShort | tooLong | twoContinuations;
+
+const std::uint8_t firstByteHighNibbleTable[16] = {
+    tooLong,
+    tooLong,
+    tooLong,
+    tooLong,
+    tooLong,
+    tooLong,
+    tooLong,
+    tooLong,
+    twoContinuations,
+    twoContinuations,
+    twoContinuations,
+    twoContinuations,
+    tooShort | overlong2,
+    tooShort,
+    tooShort | overlong3 | surrogate,
+    tooShort | tooLarge | tooLarge1000 | overlong4,
+};
+
+const std::uint8_t firstByteLowNibbleTable[16] = {
+    carry | overlong3 | overlong2 | overlong4,
+    carry | overlong2,
+    carry,
+    carry,
+    carry | tooLarge,
+    carry | tooLarge | tooLarge1000,
+    carry | tooLarge | tooLarge1000,
+    carry | tooLarge | tooLarge1000,
+    carry | tooLarge | tooLarge1000,
+    carry | tooLarge | tooLarge1000,
+    carry | tooLarge | tooLarge1000,
+    carry | tooLarge | tooLarge1000,
+    carry | tooLarge | tooLarge1000,
+    carry | tooLarge | tooLarge1000 | surrogate,
+    carry | tooLarge | tooLarge1000,
+    carry | tooLarge | tooLarge1000,
+};
+
+const std::uint8_t secondByteHighNibbleTable[16] = {
+    tooShort,
+    tooShort,
+    tooShort,
+    tooShort,
+    tooShort,
+    tooShort,
+    tooShort,
+    tooShort,
+    tooLong | overlong2 | twoContinuations | overlong3 | tooLarge1000 | overlong4,
+    tooLong | overlong2 | twoContinuations | overlong3 | tooLarge,
+    tooLong | overlong2 | twoContinuations | surrogate | tooLarge,
+    tooLong | overlong2 | twoContinuations | surrogate | tooLarge,
+    tooShort,
+    tooShort,
+    tooShort,
+    tooShort,
+};
+
+/** the largest bytes that don't start a sequence running past the end of a block */
+const std::uint8_t incompleteLimits[16] = {
+    0xFF,
+    0xFF,
+    0xFF,
+    0xFF,
+    0xFF,
+    0xFF,
+    0xFF,
+    0xFF,
+    0xFF,
+    0xFF,
+    0xFF,
+    0xFF,
+    0xFF,
+    0xF0 - 1,
+    0xE0 - 1,
+    0xC0 - 1,
+};
+
+#if defined(TEXT_USE_SSE2)
+/** @return true if the block has no errors, given that the previous 16 bytes are previous */
+__attribute__((target("ssse3"))) inline bool isBlockValidSSSE3(__m128i block,
+                                                               __m128i previous,
+                                                               std::uint8_t errorMask) noexcept
+{
+    const __m128i lowNibbleMask = _mm_set1_epi8(0x0F);
+    __m128i previous1 = _mm_alignr_epi8(block, previous, 16 - 1);
+    __m128i errors = _mm_and_si128(
+        _mm_and_si128(
+            _mm_shuffle_epi8(load(firstByteHighNibbleTable),
+                             _mm_and_si128(_mm_srli_epi16(previous1, 4), lowNibbleMask)),
+            _mm_shuffle_epi8(load(firstByteLowNibbleTable),
+                             _mm_and_si128(previous1, lowNibbleMask))),
+        _mm_shuffle_epi8(load(secondByteHighNibbleTable),
+                         _mm_and_si128(_mm_srli_epi16(block, 4), lowNibbleMask)));
+    errors = _mm_and_si128(errors, _mm_set1_epi8(static_cast<char>(errorMask)));
+    __m128i previous2 = _mm_alignr_epi8(block, previous, 16 - 2);
+    __m128i previous3 = _mm_alignr_epi8(block, previous, 16 - 3);
+    __m128i isThirdByte = _mm_subs_epu8(previous2, _mm_set1_epi8(static_cast<char>(0xE0 - 1)));
+    __m128i isFourthByte = _mm_subs_epu8(previous3, _mm_set1_epi8(static_cast<char>(0xF0 - 1)));
+    __m128i mustBeContinuation =
+        _mm_cmpgt_epi8(_mm_or_si128(isThirdByte, isFourthByte), _mm_setzero_si128());
+    errors = _mm_xor_si128(
+        errors, _mm_and_si128(mustBeContinuation, _mm_set1_epi8(static_cast<char>(0x80))));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(errors, _mm_setzero_si128())) == 0xFFFF;
+}
+
+__attribute__((target("ssse3"))) UTF8ValidationResult validateUTF8SSSE3(
+    const char *begin, const char *end, const ConvertOptions &convertOptions) noexcept
+{
+    std::uint8_t errorMask = convertOptions.allowUnpairedSurrogateCodePoints ? ~surrogate : 0xFF;
+    std::size_t size = end - begin;
+    std::size_t position = 0;
+    __m128i previous = _mm_setzero_si128();
+    const __m128i limits = load(incompleteLimits);
+    while(size - position >= blockSize)
+    {
+        __m128i block = load(begin + position);
+        bool valid;
+        if(_mm_movemask_epi8(block) == 0)
+            valid = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(previous, limits),
+                                                     _mm_setzero_si128())) == 0xFFFF;
+        else
+            valid = isBlockValidSSSE3(block, previous, errorMask);
+        if(valid)
+        {
+            previous = block;
+            position += blockSize;
+            continue;
+        }
+        std::size_t stopPosition = position + blockSize;
+        position = findSequenceStart(begin, position);
+        if(!validateUTF8Scalar(begin, end, position, stopPosition, convertOptions))
+            return UTF8ValidationResult(false, position);
+        // position is now at the start of a sequence, as if following ASCII
+        previous = _mm_setzero_si128();
+    }
+    position = findSequenceStart(begin, position);
+    if(!validateUTF8Scalar(begin, end, position, size, convertOptions))
+        return UTF8ValidationResult(false, position);
+    return UTF8ValidationResult(true, size);
+}
+
+bool hasSSSE3() noexcept
+{
+    static const bool retval = __builtin_cpu_supports("ssse3");
+    return retval;
+}
+#elif defined(TEXT_USE_NEON)
+inline bool isBlockValidNEON(uint8x16_t block,
+                             uint8x16_t previous,
+                             std::uint8_t errorMask) noexcept
+{
+    const uint8x16_t lowNibbleMask = vdupq_n_u8(0x0F);
+    uint8x16_t previous1 = vextq_u8(previous, block, 16 - 1);
+    uint8x16_t errors =
+        vandq_u8(vandq_u8(vqtbl1q_u8(vld1q_u8(firstByteHighNibbleTable), vshrq_n_u8(previous1, 4)),
+                          vqtbl1q_u8(vld1q_u8(firstByteLowNibbleTable),
+                                     vandq_u8(previous1, lowNibbleMask))),
+                 vqtbl1q_u8(vld1q_u8(secondByteHighNibbleTable), vshrq_n_u8(block, 4)));
+    errors = vandq_u8(errors, vdupq_n_u8(errorMask));
+    uint8x16_t previous2 = vextq_u8(previous, block, 16 - 2);
+    uint8x16_t previous3 = vextq_u8(previous, block, 16 - 3);
+    uint8x16_t isThirdByte = vqsubq_u8(previous2, vdupq_n_u8(0xE0 - 1));
+    uint8x16_t isFourthByte = vqsubq_u8(previous3, vdupq_n_u8(0xF0 - 1));
+    uint8x16_t mustBeContinuation = vcgtq_u8(vorrq_u8(isThirdByte, isFourthByte), vdupq_n_u8(0));
+    errors = veorq_u8(errors, vandq_u8(mustBeContinuation, vdupq_n_u8(0x80)));
+    return vmaxvq_u8(errors) == 0;
+}
+
+UTF8ValidationResult validateUTF8NEON(const char *begin,
+                                      const char *end,
+                                      const ConvertOptions &convertOptions) noexcept
+{
+    std::uint8_t errorMask = convertOptions.allowUnpairedSurrogateCodePoints ? ~surrogate : 0xFF;
+    std::size_t size = end - begin;
+    std::size_t position = 0;
+    uint8x16_t previous = vdupq_n_u8(0);
+    const uint8x16_t limits = vld1q_u8(incompleteLimits);
+    while(size - position >= blockSize)
+    {
+        uint8x16_t block = vld1q_u8(reinterpret_cast<const std::uint8_t *>(begin + position));
+        bool valid;
+        if(vmaxvq_u8(block) < 0x80)
+            valid = vmaxvq_u8(vqsubq_u8(previous, limits)) == 0;
+        else
+            valid = isBlockValidNEON(block, previous, errorMask);
+        if(valid)
+        {
+            previous = block;
+            position += blockSize;
+            continue;
+        }
+        std::size_t stopPosition = position + blockSize;
+        position = findSequenceStart(begin, position);
+        if(!validateUTF8Scalar(begin, end, position, stopPosition, convertOptions))
+            return UTF8ValidationResult(false, position);
+        previous = vdupq_n_u8(0);
+    }
+    position = findSequenceStart(begin, position);
+    if(!validateUTF8Scalar(begin, end, position, size, convertOptions))
+        return UTF8ValidationResult(false, position);
+    return UTF8ValidationResult(true, size);
+}
+#endif
+}
+
+UTF8ValidationResult validateUTF8(const char *begin,
+                                  const char *end,
+                                  const ConvertOptions &convertOptions) noexcept
+{
+#if defined(TEXT_USE_SSE2)
+    if(hasSSSE3())
+        return validateUTF8SSSE3(begin, end, convertOptions);
+#elif defined(TEXT_USE_NEON)
+    return validateUTF8NEON(begin, end, convertOptions);
+#endif
+    std::size_t position = 0;
+    if(!validateUTF8Scalar(begin, end, position, end - begin, convertOptions))
+        return UTF8ValidationResult(false, position);
+    return UTF8ValidationResult(true, end - begin);
+}
+}
+}
+}
+}
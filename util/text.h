@@ -23,12 +23,14 @@
 #define UTIL_TEXT_H_
 
 #include <type_traits>
+#include <algorithm>
 #include <utility>
 #include <limits>
 #include <cstdint>
 #include <string>
 #include <ostream>
 #include "constexpr_assert.h"
+#include "hash.h"
 
 namespace programmerjake
 {
@@ -86,9 +88,9 @@ typename std::char_traits<char32_t>::int_type decodeUTF8(
         return errorValue;
     if(!allowSurrogateCodePoints && byte0 == 0xED && byte1 >= 0xA0)
         return errorValue;
+    ++iter;
     if(iter == sentinel)
         return errorValue;
-    ++iter;
     auto byte2 = static_cast<std::uint8_t>(static_cast<char>(*iter));
     ++iter;
     if(byte2 < 0x80 || byte2 >= 0xC0)
@@ -231,7 +233,7 @@ public:
 
 inline EncodedCharacter<char, 4> encodeUTF8(char32_t ch, bool use2ByteNull = false) noexcept
 {
-    constexprAssert(ch < 0x10FFFFUL && ch >= 0);
+    constexprAssert(ch <= 0x10FFFFUL);
     if(use2ByteNull && ch == 0)
         return EncodedCharacter<char, 4>(0xC0U, 0x80U);
     if(ch < 0x80)
@@ -275,7 +277,7 @@ typename std::char_traits<char32_t>::int_type decodeUTF16(
 
 inline EncodedCharacter<char16_t, 2> encodeUTF16(char32_t ch) noexcept
 {
-    constexprAssert(ch < 0x10FFFFUL && ch >= 0);
+    constexprAssert(ch <= 0x10FFFFUL);
     if(ch < 0x10000UL)
         return EncodedCharacter<char16_t, 2>(ch);
     return EncodedCharacter<char16_t, 2>(0xD800U | ((ch - 0x10000UL) >> 10),
@@ -367,6 +369,80 @@ typename std::char_traits<char32_t>::int_type decodeWide(
         iteratorWrapper, std::move(sentinel), allowUnpairedSurrogateCodeUnits, errorValue);
 }
 
+/** copies the leading ASCII characters of source to destination, stopping at the first
+ * non-ASCII character or after size characters; uses vector instructions where available
+ * @return the number of characters copied
+ */
+std::size_t convertASCIIPrefix(const char *source,
+                               std::size_t size,
+                               char16_t *destination) noexcept;
+std::size_t convertASCIIPrefix(const char *source,
+                               std::size_t size,
+                               char32_t *destination) noexcept;
+std::size_t convertASCIIPrefix(const char16_t *source,
+                               std::size_t size,
+                               char *destination) noexcept;
+std::size_t convertASCIIPrefix(const char32_t *source,
+                               std::size_t size,
+                               char *destination) noexcept;
+
+/** @return the number of leading ASCII characters in the first size characters of source */
+std::size_t getASCIIPrefixLength(const char *source, std::size_t size) noexcept;
+std::size_t getASCIIPrefixLength(const char16_t *source, std::size_t size) noexcept;
+std::size_t getASCIIPrefixLength(const char32_t *source, std::size_t size) noexcept;
+std::size_t getASCIIPrefixLength(const wchar_t *source, std::size_t size) noexcept;
+
+/** picks the fastest way to copy an ASCII prefix between two character types */
+template <typename SourceCharType, typename TargetCharType>
+struct ASCIIPrefixConverter final
+{
+    static std::size_t run(const SourceCharType *source,
+                           std::size_t size,
+                           TargetCharType *destination) noexcept
+    {
+        std::size_t retval = getASCIIPrefixLength(source, size);
+        for(std::size_t i = 0; i < retval; i++)
+            destination[i] = static_cast<TargetCharType>(source[i]);
+        return retval;
+    }
+};
+
+template <>
+struct ASCIIPrefixConverter<char, char16_t> final
+{
+    static std::size_t run(const char *source, std::size_t size, char16_t *destination) noexcept
+    {
+        return convertASCIIPrefix(source, size, destination);
+    }
+};
+
+template <>
+struct ASCIIPrefixConverter<char, char32_t> final
+{
+    static std::size_t run(const char *source, std::size_t size, char32_t *destination) noexcept
+    {
+        return convertASCIIPrefix(source, size, destination);
+    }
+};
+
+template <>
+struct ASCIIPrefixConverter<char16_t, char> final
+{
+    static std::size_t run(const char16_t *source, std::size_t size, char *destination) noexcept
+    {
+        return convertASCIIPrefix(source, size, destination);
+    }
+};
+
+template <>
+struct ASCIIPrefixConverter<char32_t, char> final
+{
+    static std::size_t run(const char32_t *source, std::size_t size, char *destination) noexcept
+    {
+        return convertASCIIPrefix(source, size, destination);
+    }
+};
+
 struct ConvertOptions final
 {
     typename std::char_traits<char32_t>::int_type errorValue = replacementCharacter;
@@ -398,21 +474,50 @@ struct ConvertOptions final
     }
 };
 
+struct UTF8ValidationResult final
+{
+    bool valid;
+    /** the offset of the start of the first sequence decodeUTF8 would reject, or the size of the
+     * input if it is valid */
+    std::size_t errorOffset;
+    constexpr UTF8ValidationResult(bool valid, std::size_t errorOffset)
+        : valid(valid), errorOffset(errorOffset)
+    {
+    }
+    explicit constexpr operator bool() const
+    {
+        return valid;
+    }
+};
+
+/** checks that decodeUTF8 with convertOptions decodes [begin, end) without errors, 16 bytes at a
+ * time where vector instructions are available */
+UTF8ValidationResult validateUTF8(const char *begin,
+                                  const char *end,
+                                  const ConvertOptions &convertOptions = ConvertOptions()) noexcept;
+
+template <typename Traits, typename Allocator>
+UTF8ValidationResult validateUTF8(const std::basic_string<char, Traits, Allocator> &text,
+                                  const ConvertOptions &convertOptions = ConvertOptions()) noexcept
+{
+    return validateUTF8(text.data(), text.data() + text.size(), convertOptions);
+}
+
 template <typename CharType>
 struct DecodeEncodeHelper
 {
     template <typename InputIterator, typename Sentinel>
-    typename std::char_traits<char32_t>::int_type decode(
+    static typename std::char_traits<char32_t>::int_type decode(
         InputIterator &iter, Sentinel sentinel, const ConvertOptions &convertOptions) = delete;
-    EncodedCharacter<CharType, 1> encode(char32_t ch,
-                                         const ConvertOptions &convertOptions) noexcept = delete;
+    static EncodedCharacter<CharType, 1> encode(
+        char32_t ch, const ConvertOptions &convertOptions) noexcept = delete;
 };
 
 template <>
 struct DecodeEncodeHelper<char>
 {
     template <typename InputIterator, typename Sentinel>
-    typename std::char_traits<char32_t>::int_type decode(
+    static typename std::char_traits<char32_t>::int_type decode(
         InputIterator &iter,
         Sentinel sentinel,
         const ConvertOptions &
@@ -425,7 +530,8 @@ struct DecodeEncodeHelper<char>
                           convertOptions.allow2ByteNull,
                           convertOptions.errorValue);
     }
-    EncodedCharacter<char, 4> encode(char32_t ch, const ConvertOptions &convertOptions) noexcept
+    static EncodedCharacter<char, 4> encode(char32_t ch,
+                                            const ConvertOptions &convertOptions) noexcept
     {
         return encodeUTF8(ch, convertOptions.use2ByteNull);
     }
@@ -435,7 +541,7 @@ template <>
 struct DecodeEncodeHelper<char16_t>
 {
     template <typename InputIterator, typename Sentinel>
-    typename std::char_traits<char32_t>::int_type decode(
+    static typename std::char_traits<char32_t>::int_type decode(
         InputIterator &iter,
         Sentinel sentinel,
         const ConvertOptions &
@@ -447,7 +553,8 @@ struct DecodeEncodeHelper<char16_t>
                            convertOptions.allowUnpairedSurrogateCodePoints,
                            convertOptions.errorValue);
     }
-    EncodedCharacter<char16_t, 2> encode(char32_t ch, const ConvertOptions &convertOptions) noexcept
+    static EncodedCharacter<char16_t, 2> encode(char32_t ch,
+                                                const ConvertOptions &convertOptions) noexcept
     {
         return encodeUTF16(ch);
     }
@@ -457,7 +564,7 @@ template <>
 struct DecodeEncodeHelper<char32_t>
 {
     template <typename InputIterator, typename Sentinel>
-    typename std::char_traits<char32_t>::int_type decode(
+    static typename std::char_traits<char32_t>::int_type decode(
         InputIterator &iter,
         Sentinel sentinel,
         const ConvertOptions &
@@ -469,7 +576,8 @@ struct DecodeEncodeHelper<char32_t>
                            convertOptions.allowUnpairedSurrogateCodePoints,
                            convertOptions.errorValue);
     }
-    EncodedCharacter<char32_t, 1> encode(char32_t ch, const ConvertOptions &convertOptions) noexcept
+    static EncodedCharacter<char32_t, 1> encode(char32_t ch,
+                                                const ConvertOptions &convertOptions) noexcept
     {
         return encodeUTF32(ch);
     }
@@ -479,7 +587,7 @@ template <>
 struct DecodeEncodeHelper<wchar_t>
 {
     template <typename InputIterator, typename Sentinel>
-    typename std::char_traits<char32_t>::int_type decode(
+    static typename std::char_traits<char32_t>::int_type decode(
         InputIterator &iter,
         Sentinel sentinel,
         const ConvertOptions &
@@ -491,12 +599,266 @@ struct DecodeEncodeHelper<wchar_t>
                           convertOptions.allowUnpairedSurrogateCodePoints,
                           convertOptions.errorValue);
     }
-    EncodedCharacter<wchar_t, 2> encode(char32_t ch, const ConvertOptions &convertOptions) noexcept
+    static EncodedCharacter<wchar_t, 2> encode(char32_t ch,
+                                               const ConvertOptions &convertOptions) noexcept
     {
         return encodeWide(ch);
     }
 };
 
+/** ASCII decodes to itself and encodes as one character in every encoding, except that
+ * use2ByteNull encodes a UTF-8 null as two bytes
+ * @return the length of the prefix of the asciiLength ASCII characters at begin that can be
+ * copied as is
+ */
+template <typename TargetCharType, typename SourceCharType>
+std::size_t getCopyableASCIIPrefixLength(const SourceCharType *begin,
+                                         std::size_t asciiLength,
+                                         const ConvertOptions &convertOptions) noexcept
+{
+    if(std::is_same<TargetCharType, char>::value && convertOptions.use2ByteNull)
+    {
+        const SourceCharType *asciiEnd = begin + asciiLength;
+        for(const SourceCharType *iter = begin; iter != asciiEnd; ++iter)
+            if(*iter == 0)
+                return iter - begin;
+    }
+    return asciiLength;
+}
+
+template <typename CharType>
+bool isASCIIRunStart(const CharType *begin, const CharType *end) noexcept
+{
+    typedef typename std::make_unsigned<CharType>::type UnsignedType;
+    if(static_cast<UnsignedType>(begin[0]) >= 0x80)
+        return false;
+    return end - begin < 2 || static_cast<UnsignedType>(begin[1]) < 0x80;
+}
+
+/** @return the number of characters transcode writes for [begin, end) */
+template <typename TargetCharType, typename SourceCharType>
+std::size_t getTranscodedSize(const SourceCharType *begin,
+                              const SourceCharType *end,
+                              const ConvertOptions &convertOptions)
+{
+    std::size_t retval = 0;
+    while(begin != end)
+    {
+        // only call out for runs of ASCII, since a call per character costs more than it saves
+        if(isASCIIRunStart(begin, end))
+        {
+            std::size_t asciiLength = getCopyableASCIIPrefixLength<TargetCharType>(
+                begin, getASCIIPrefixLength(begin, end - begin), convertOptions);
+            begin += asciiLength;
+            retval += asciiLength;
+            if(begin == end)
+                break;
+        }
+        retval += DecodeEncodeHelper<TargetCharType>::encode(
+                      DecodeEncodeHelper<SourceCharType>::decode(begin, end, convertOptions),
+                      convertOptions).size();
+    }
+    return retval;
+}
+
+/** converts [begin, end) into output, which must have room for
+ * getTranscodedSize<TargetCharType>(begin, end, convertOptions) characters
+ * @return the end of the characters written
+ */
+template <typename TargetCharType, typename SourceCharType>
+TargetCharType *transcode(const SourceCharType *begin,
+                          const SourceCharType *end,
+                          TargetCharType *output,
+                          const ConvertOptions &convertOptions)
+{
+    while(begin != end)
+    {
+        if(isASCIIRunStart(begin, end))
+        {
+            std::size_t asciiLength = ASCIIPrefixConverter<SourceCharType, TargetCharType>::run(
+                begin, end - begin, output);
+            asciiLength =
+                getCopyableASCIIPrefixLength<TargetCharType>(begin, asciiLength, convertOptions);
+            begin += asciiLength;
+            output += asciiLength;
+            if(begin == end)
+                break;
+        }
+        auto encoded = DecodeEncodeHelper<TargetCharType>::encode(
+            DecodeEncodeHelper<SourceCharType>::decode(begin, end, convertOptions),
+            convertOptions);
+        for(TargetCharType ch : encoded)
+            *output++ = ch;
+    }
+    return output;
+}
+
+struct TranscodeResult final
+{
+    /** the number of source characters used, including ones held for the next chunk */
+    std::size_t consumed;
+    /** the number of characters written */
+    std::size_t produced;
+    constexpr TranscodeResult(std::size_t consumed, std::size_t produced)
+        : consumed(consumed), produced(produced)
+    {
+    }
+};
+
+/** converts text a chunk at a time into caller-provided buffers without allocating. A sequence
+ * split between chunks is held until the rest of it arrives, so the output is the same as
+ * transcoding the concatenated chunks.
+ */
+template <typename TargetCharType, typename SourceCharType>
+class Transcoder final
+{
+public:
+    /** the most source characters one code point takes */
+    static constexpr std::size_t maxSourceSequenceSize =
+        decltype(DecodeEncodeHelper<SourceCharType>::encode(U'\0', ConvertOptions()))::maxChars;
+    /** an output buffer with room for this many characters always fits the next code point */
+    static constexpr std::size_t maxEncodedSize =
+        decltype(DecodeEncodeHelper<TargetCharType>::encode(U'\0', ConvertOptions()))::maxChars;
+
+private:
+    ConvertOptions convertOptions;
+    SourceCharType pending[maxSourceSequenceSize];
+    std::size_t pendingSize;
+
+private:
+    template <bool write>
+    bool put(char32_t ch, TargetCharType *output, std::size_t &produced, std::size_t outputSize)
+    {
+        auto encoded = DecodeEncodeHelper<TargetCharType>::encode(ch, convertOptions);
+        if(outputSize - produced < encoded.size())
+            return false;
+        if(write)
+            for(std::size_t i = 0; i < encoded.size(); i++)
+                output[produced + i] = encoded[i];
+        produced += encoded.size();
+        return true;
+    }
+    template <bool write>
+    TranscodeResult run(const SourceCharType *source,
+                        std::size_t sourceSize,
+                        TargetCharType *output,
+                        std::size_t outputSize,
+                        bool isLastChunk)
+    {
+        std::size_t consumed = 0;
+        std::size_t produced = 0;
+        while(pendingSize > 0)
+        {
+            SourceCharType sequence[maxSourceSequenceSize];
+            std::size_t copied = maxSourceSequenceSize - pendingSize;
+            if(copied > sourceSize - consumed)
+                copied = sourceSize - consumed;
+            std::copy(pending, pending + pendingSize, sequence);
+            std::copy(source + consumed, source + consumed + copied, sequence + pendingSize);
+            std::size_t available = pendingSize + copied;
+            const SourceCharType *iter = sequence;
+            auto ch = DecodeEncodeHelper<SourceCharType>::decode(
+                iter, static_cast<const SourceCharType *>(sequence + available), convertOptions);
+            std::size_t decodedSize = iter - sequence;
+            if(decodedSize == available && available < maxSourceSequenceSize && !isLastChunk)
+            {
+                // the next chunk may continue the sequence
+                std::copy(sequence + pendingSize, sequence + available, pending + pendingSize);
+                pendingSize = available;
+                return TranscodeResult(consumed + copied, produced);
+            }
+            if(!put<write>(static_cast<char32_t>(ch), output, produced, outputSize))
+                return TranscodeResult(consumed, produced);
+            if(decodedSize >= pendingSize)
+            {
+                consumed += decodedSize - pendingSize;
+                pendingSize = 0;
+            }
+            else
+            {
+                std::copy(pending + decodedSize, pending + pendingSize, pending);
+                pendingSize -= decodedSize;
+            }
+        }
+        const SourceCharType *end = source + sourceSize;
+        while(consumed < sourceSize)
+        {
+            const SourceCharType *begin = source + consumed;
+            if(isASCIIRunStart(begin, end))
+            {
+                std::size_t asciiLength = sourceSize - consumed;
+                if(asciiLength > outputSize - produced)
+                    asciiLength = outputSize - produced;
+                if(write)
+                    asciiLength = ASCIIPrefixConverter<SourceCharType, TargetCharType>::run(
+                        begin, asciiLength, output + produced);
+                else
+                    asciiLength = getASCIIPrefixLength(begin, asciiLength);
+                asciiLength = getCopyableASCIIPrefixLength<TargetCharType>(
+                    begin, asciiLength, convertOptions);
+                consumed += asciiLength;
+                produced += asciiLength;
+                if(consumed == sourceSize)
+                    break;
+                begin += asciiLength;
+            }
+            const SourceCharType *iter = begin;
+            auto ch = DecodeEncodeHelper<SourceCharType>::decode(iter, end, convertOptions);
+            if(iter == end && sourceSize - consumed < maxSourceSequenceSize && !isLastChunk)
+            {
+                pendingSize = sourceSize - consumed;
+                std::copy(begin, end, pending);
+                return TranscodeResult(sourceSize, produced);
+            }
+            if(!put<write>(static_cast<char32_t>(ch), output, produced, outputSize))
+                break;
+            consumed = iter - source;
+        }
+        return TranscodeResult(consumed, produced);
+    }
+
+public:
+    explicit Transcoder(const ConvertOptions &convertOptions = ConvertOptions()) noexcept
+        : convertOptions(convertOptions),
+          pending(),
+          pendingSize(0)
+    {
+    }
+    /** converts as much of source as fits in output
+     * @param isLastChunk true if no more source follows, so a sequence cut off at the end is an
+     * error instead of being held for the next chunk
+     */
+    TranscodeResult convert(const SourceCharType *source,
+                            std::size_t sourceSize,
+                            TargetCharType *output,
+                            std::size_t outputSize,
+                            bool isLastChunk)
+    {
+        return run<true>(source, sourceSize, output, outputSize, isLastChunk);
+    }
+    /** @return the number of characters convert would write for source given enough room,
+     * without writing anything or changing the held sequence
+     */
+    std::size_t measure(const SourceCharType *source,
+                        std::size_t sourceSize,
+                        bool isLastChunk) const
+    {
+        Transcoder copy(*this);
+        return copy.template run<false>(
+                       source, sourceSize, nullptr, static_cast<std::size_t>(-1), isLastChunk)
+            .produced;
+    }
+    /** @return true if part of a sequence is held for the next chunk */
+    bool hasPendingInput() const noexcept
+    {
+        return pendingSize != 0;
+    }
+    void reset() noexcept
+    {
+        pendingSize = 0;
+    }
+};
+
 template <typename Target, typename Source>
 struct StringCastHelper;
 
@@ -513,13 +875,16 @@ struct StringCastHelper<std::basic_string<TargetCharType, TargetTraits, TargetAl
         const std::basic_string<SourceCharType, SourceTraits, SourceAllocator> &source,
         const ConvertOptions &convertOptions)
     {
-        std::basic_string<TargetCharType, TargetTraits, TargetAllocator> retval;
-        for(auto iter = source.begin(); iter != source.end();)
+        const SourceCharType *begin = source.data();
+        const SourceCharType *end = begin + source.size();
+        std::size_t size = getTranscodedSize<TargetCharType>(begin, end, convertOptions);
+        std::basic_string<TargetCharType, TargetTraits, TargetAllocator> retval(
+            size, TargetCharType());
+        if(size > 0)
         {
-            retval = std::move(retval) + DecodeEncodeHelper<TargetCharType>::encode(
-                                             DecodeEncodeHelper<SourceCharType>::decode(
-                                                 iter, source.end(), convertOptions),
-                                             convertOptions);
+            TargetCharType *outputEnd = transcode(begin, end, &retval[0], convertOptions);
+            constexprAssert(outputEnd == &retval[0] + size);
+            static_cast<void>(outputEnd);
         }
         return retval;
     }
@@ -571,9 +936,315 @@ Target stringCast(Source &&source)
     return StringCastHelper<Target, typename std::decay<Source>::type>::run(
         std::forward<Source>(source), ConvertOptions());
 }
+
+/** decodes and encodes literals in constant expressions, one code point at a time. Literals are
+ * expected to be valid, so unless NDEBUG is defined invalid UTF-8 is a compile error instead of
+ * being replaced
+ */
+template <typename CharType>
+struct LiteralEncoding;
+
+template <>
+struct LiteralEncoding<char>
+{
+    static constexpr unsigned char getByte(const char *s, std::size_t size, std::size_t index)
+    {
+        return (constexprAssert(index < size), static_cast<unsigned char>(s[index]));
+    }
+    static constexpr std::size_t getSequenceSize(const char *s,
+                                                 std::size_t size,
+                                                 std::size_t index)
+    {
+        return getByte(s, size, index) < 0x80 ? 1 : getByte(s, size, index) < 0xC2 ?
+                                                (constexprAssert(!"invalid UTF-8"), 1) :
+                                                getByte(s, size, index) < 0xE0 ?
+                                                2 :
+                                                getByte(s, size, index) < 0xF0 ?
+                                                3 :
+                                                getByte(s, size, index) < 0xF5 ?
+                                                4 :
+                                                (constexprAssert(!"invalid UTF-8"), 1);
+    }
+    static constexpr char32_t getContinuationBits(const char *s,
+                                                  std::size_t size,
+                                                  std::size_t index)
+    {
+        return (constexprAssert((getByte(s, size, index) & 0xC0) == 0x80),
+                static_cast<char32_t>(getByte(s, size, index) & 0x3F));
+    }
+    static constexpr char32_t decodeUnchecked(const char *s, std::size_t size, std::size_t index)
+    {
+        return getSequenceSize(s, size, index) == 1 ?
+                   getByte(s, size, index) :
+                   getSequenceSize(s, size, index) == 2 ?
+                   (static_cast<char32_t>(getByte(s, size, index) & 0x1F) << 6)
+                       | getContinuationBits(s, size, index + 1) :
+                   getSequenceSize(s, size, index) == 3 ?
+                   (static_cast<char32_t>(getByte(s, size, index) & 0xF) << 12)
+                       | (getContinuationBits(s, size, index + 1) << 6)
+                       | getContinuationBits(s, size, index + 2) :
+                   (static_cast<char32_t>(getByte(s, size, index) & 0x7) << 18)
+                       | (getContinuationBits(s, size, index + 1) << 12)
+                       | (getContinuationBits(s, size, index + 2) << 6)
+                       | getContinuationBits(s, size, index + 3);
+    }
+    /** rejects overlong forms and surrogates, which the lead byte alone doesn't catch */
+    static constexpr char32_t checkDecoded(char32_t ch, std::size_t sequenceSize)
+    {
+        return (constexprAssert(getEncodedSize(ch) == sequenceSize && ch <= 0x10FFFFUL
+                                && (ch < 0xD800 || ch > 0xDFFF)),
+                ch);
+    }
+    static constexpr char32_t decode(const char *s, std::size_t size, std::size_t index)
+    {
+        return checkDecoded(decodeUnchecked(s, size, index), getSequenceSize(s, size, index));
+    }
+    static constexpr std::size_t getEncodedSize(char32_t ch)
+    {
+        return ch < 0x80 ? 1 : ch < 0x800 ? 2 : ch < 0x10000 ? 3 : 4;
+    }
+    static constexpr char encode(char32_t ch, std::size_t index)
+    {
+        return static_cast<char>(
+            index != 0 ? 0x80 | ((ch >> (6 * (getEncodedSize(ch) - 1 - index))) & 0x3F) :
+                         getEncodedSize(ch) == 1 ? ch : getEncodedSize(ch) == 2 ?
+                                                   0xC0 | (ch >> 6) :
+                                                   getEncodedSize(ch) == 3 ? 0xE0 | (ch >> 12) :
+                                                                             0xF0 | (ch >> 18));
+    }
+};
+
+template <typename CharType>
+struct UTF16LiteralEncoding
+{
+    static constexpr bool isHighSurrogate(CharType ch)
+    {
+        return static_cast<char32_t>(ch) >= 0xD800 && static_cast<char32_t>(ch) < 0xDC00;
+    }
+    static constexpr bool isLowSurrogate(CharType ch)
+    {
+        return static_cast<char32_t>(ch) >= 0xDC00 && static_cast<char32_t>(ch) < 0xE000;
+    }
+    /** unpaired surrogates decode to themselves, as decodeUTF16 does */
+    static constexpr std::size_t getSequenceSize(const CharType *s,
+                                                 std::size_t size,
+                                                 std::size_t index)
+    {
+        return isHighSurrogate(s[index]) && index + 1 < size && isLowSurrogate(s[index + 1]) ? 2 :
+                                                                                             1;
+    }
+    static constexpr char32_t decode(const CharType *s, std::size_t size, std::size_t index)
+    {
+        return getSequenceSize(s, size, index) == 1 ?
+                   static_cast<char32_t>(s[index]) :
+                   0x10000 + ((static_cast<char32_t>(s[index]) & 0x3FF) << 10)
+                       + (static_cast<char32_t>(s[index + 1]) & 0x3FF);
+    }
+    static constexpr std::size_t getEncodedSize(char32_t ch)
+    {
+        return ch < 0x10000 ? 1 : 2;
+    }
+    static constexpr CharType encode(char32_t ch, std::size_t index)
+    {
+        return static_cast<CharType>(getEncodedSize(ch) == 1 ? ch : index == 0 ?
+                                                               0xD800 | ((ch - 0x10000) >> 10) :
+                                                               0xDC00 | (ch & 0x3FF));
+    }
+};
+
+template <typename CharType>
+struct UTF32LiteralEncoding
+{
+    static constexpr std::size_t getSequenceSize(const CharType *, std::size_t, std::size_t)
+    {
+        return 1;
+    }
+    static constexpr char32_t decode(const CharType *s, std::size_t size, std::size_t index)
+    {
+        return (constexprAssert(static_cast<char32_t>(s[index]) <= 0x10FFFFUL),
+                static_cast<char32_t>(s[index]));
+    }
+    static constexpr std::size_t getEncodedSize(char32_t)
+    {
+        return 1;
+    }
+    static constexpr CharType encode(char32_t ch, std::size_t)
+    {
+        return static_cast<CharType>(ch);
+    }
+};
+
+template <>
+struct LiteralEncoding<char16_t> : public UTF16LiteralEncoding<char16_t>
+{
+};
+
+template <>
+struct LiteralEncoding<char32_t> : public UTF32LiteralEncoding<char32_t>
+{
+};
+
+template <>
+struct LiteralEncoding<wchar_t>
+    : public std::conditional<isWideCharacterUTF16,
+                              UTF16LiteralEncoding<wchar_t>,
+                              UTF32LiteralEncoding<wchar_t>>::type
+{
+};
+
+/** walks a literal a code point at a time; C++11 constexpr functions can't loop, so the walks
+ * are recursive, the literal length is bounded by the compiler's constexpr depth limit, and
+ * finding each output character rescans from the start. That's fine for names and other short
+ * literals, but long ones slow down compiling noticeably.
+ */
+template <typename TargetCharType, typename SourceCharType>
+struct LiteralTranscoder final
+{
+    typedef LiteralEncoding<SourceCharType> Source;
+    typedef LiteralEncoding<TargetCharType> Target;
+    static constexpr std::size_t getSize(const SourceCharType *s,
+                                         std::size_t size,
+                                         std::size_t index = 0)
+    {
+        return index >= size ? 0 : Target::getEncodedSize(Source::decode(s, size, index))
+                                       + getSize(s, size, index + Source::getSequenceSize(
+                                                                      s, size, index));
+    }
+    /** @return the outputIndex-th character of the transcoded literal */
+    static constexpr TargetCharType getChar(const SourceCharType *s,
+                                            std::size_t size,
+                                            std::size_t outputIndex,
+                                            std::size_t index = 0)
+    {
+        return Target::getEncodedSize(Source::decode(s, size, index)) > outputIndex ?
+                   Target::encode(Source::decode(s, size, index), outputIndex) :
+                   getChar(s,
+                           size,
+                           outputIndex - Target::getEncodedSize(Source::decode(s, size, index)),
+                           index + Source::getSequenceSize(s, size, index));
+    }
+    static constexpr std::uint64_t hashCodePoint(char32_t ch,
+                                                 std::uint64_t state,
+                                                 std::size_t byteIndex = 0)
+    {
+        return byteIndex >= LiteralEncoding<char>::getEncodedSize(ch) ?
+                   state :
+                   hashCodePoint(ch,
+                                 hash::FNV1a64::update(state,
+                                                       static_cast<unsigned char>(
+                                                           LiteralEncoding<char>::encode(
+                                                               ch, byteIndex))),
+                                 byteIndex + 1);
+    }
+    /** @return hash::FNV1a64 of the literal's UTF-8 form, whatever its encoding */
+    static constexpr std::uint64_t getUTF8Hash(const SourceCharType *s,
+                                               std::size_t size,
+                                               std::size_t index = 0,
+                                               std::uint64_t state = hash::FNV1a64::offsetBasis)
+    {
+        return index >= size ? state :
+                               getUTF8Hash(s,
+                                           size,
+                                           index + Source::getSequenceSize(s, size, index),
+                                           hashCodePoint(Source::decode(s, size, index), state));
+    }
+};
+
+template <std::size_t... Indices>
+struct IndexSequence final
+{
+};
+
+template <std::size_t N, std::size_t... Indices>
+struct MakeIndexSequence : public MakeIndexSequence<N - 1, N - 1, Indices...>
+{
+};
+
+template <std::size_t... Indices>
+struct MakeIndexSequence<0, Indices...>
+{
+    typedef IndexSequence<Indices...> type;
+};
+
+/** a literal transcoded at compile time, as made by transcodeLiteral */
+template <typename T, std::size_t N>
+struct TranscodedLiteral final
+{
+    typedef T CharType;
+    /** null terminated */
+    CharType chars[N + 1];
+    /** hash::FNV1a64 of the UTF-8 form, for looking up names without hashing them at runtime */
+    std::uint64_t utf8Hash;
+    typedef const CharType *const_iterator;
+    constexpr const_iterator begin() const
+    {
+        return &chars[0];
+    }
+    constexpr const_iterator end() const
+    {
+        return &chars[N];
+    }
+    constexpr const CharType *c_str() const
+    {
+        return &chars[0];
+    }
+    constexpr std::size_t size() const
+    {
+        return N;
+    }
+    constexpr const CharType &operator[](std::size_t index) const
+    {
+        return (constexprAssert(index < N), chars[index]);
+    }
+    std::basic_string<CharType> toString() const
+    {
+        return std::basic_string<CharType>(begin(), end());
+    }
+};
+
+template <typename TargetCharType, typename SourceCharType, std::size_t SourceSize>
+constexpr std::size_t getTranscodedLiteralSize(const SourceCharType(&literal)[SourceSize])
+{
+    return LiteralTranscoder<TargetCharType, SourceCharType>::getSize(literal, SourceSize - 1);
+}
+
+template <typename TargetCharType,
+          std::size_t N,
+          typename SourceCharType,
+          std::size_t SourceSize,
+          std::size_t... Indices>
+constexpr TranscodedLiteral<TargetCharType, N> makeTranscodedLiteralHelper(
+    const SourceCharType(&literal)[SourceSize], IndexSequence<Indices...>)
+{
+    return TranscodedLiteral<TargetCharType, N>{
+        {LiteralTranscoder<TargetCharType, SourceCharType>::getChar(
+             literal, SourceSize - 1, Indices)...,
+         TargetCharType()},
+        LiteralTranscoder<TargetCharType, SourceCharType>::getUTF8Hash(literal, SourceSize - 1)};
+}
+
+/** N must be getTranscodedLiteralSize<TargetCharType>(literal); use transcodeLiteral instead */
+template <typename TargetCharType, std::size_t N, typename SourceCharType, std::size_t SourceSize>
+constexpr TranscodedLiteral<TargetCharType, N> makeTranscodedLiteral(
+    const SourceCharType(&literal)[SourceSize])
+{
+    return (constexprAssert(getTranscodedLiteralSize<TargetCharType>(literal) == N),
+            makeTranscodedLiteralHelper<TargetCharType, N>(
+                literal, typename MakeIndexSequence<N>::type()));
 }
 }
 }
 }
+}
+
+/** transcodes a string literal to TargetCharType at compile time when used in a constant
+ * expression, such as to initialize a constexpr variable
+ * @return a TranscodedLiteral
+ */
+#define transcodeLiteral(TargetCharType, literal)                                         \
+    (::programmerjake::voxels::util::text::makeTranscodedLiteral<                         \
+        TargetCharType,                                                                   \
+        ::programmerjake::voxels::util::text::getTranscodedLiteralSize<TargetCharType>( \
+            literal)>(literal))
 
 #endif /* UTIL_TEXT_H_ */
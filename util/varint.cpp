@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#include "varint.h"
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VARINT_USE_SSSE3
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__) && !defined(__ARM_BIG_ENDIAN)
+#define VARINT_USE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace util
+{
+namespace varint
+{
+namespace
+{
+struct StreamVByteTables final
+{
+    unsigned char dataSizes[256];
+    unsigned char shuffles[256][16];
+    StreamVByteTables()
+    {
+        for(std::size_t control = 0; control < 256; control++)
+        {
+            std::size_t dataSize = 0;
+            for(std::size_t lane = 0; lane < 4; lane++)
+            {
+                std::size_t byteCount = ((control >> (2 * lane)) & 3) + 1;
+                for(std::size_t i = 0; i < 4; i++)
+                {
+                    shuffles[control][lane * 4 + i] =
+                        i < byteCount ? static_cast<unsigned char>(dataSize + i) : 0xFF;
+                }
+                dataSize += byteCount;
+            }
+            dataSizes[control] = static_cast<unsigned char>(dataSize);
+        }
+    }
+    static const StreamVByteTables &get()
+    {
+        static const StreamVByteTables retval;
+        return retval;
+    }
+};
+
+inline std::size_t getStreamVByteCode(std::uint32_t value) noexcept
+{
+    if(value < 0x100UL)
+        return 0;
+    if(value < 0x10000UL)
+        return 1;
+    if(value < 0x1000000UL)
+        return 2;
+    return 3;
+}
+
+inline std::uint32_t loadStreamVByteValue(const unsigned char *data, std::size_t code) noexcept
+{
+    std::uint32_t retval = data[0];
+    if(code >= 1)
+        retval |= static_cast<std::uint32_t>(data[1]) << 8;
+    if(code >= 2)
+        retval |= static_cast<std::uint32_t>(data[2]) << 16;
+    if(code >= 3)
+        retval |= static_cast<std::uint32_t>(data[3]) << 24;
+    return retval;
+}
+
+/** decodes the values [startIndex, count) one at a time
+ * @return the number of data bytes read
+ */
+std::size_t decodeScalarTail(const unsigned char *controlBytes,
+                             const unsigned char *data,
+                             std::uint32_t *values,
+                             std::size_t startIndex,
+                             std::size_t count) noexcept
+{
+    const unsigned char *dataStart = data;
+    for(std::size_t i = startIndex; i < count; i++)
+    {
+        std::size_t code = (controlBytes[i / 4] >> (2 * (i % 4))) & 3;
+        values[i] = loadStreamVByteValue(data, code);
+        data += code + 1;
+    }
+    return data - dataStart;
+}
+
+#ifdef VARINT_USE_SSSE3
+__attribute__((target("ssse3"))) std::size_t decodeSSSE3(const unsigned char *input,
+                                                          std::size_t inputSize,
+                                                          std::uint32_t *values,
+                                                          std::size_t count) noexcept
+{
+    const StreamVByteTables &tables = StreamVByteTables::get();
+    const unsigned char *controlBytes = input;
+    const unsigned char *data = input + getStreamVByteControlSize(count);
+    const unsigned char *inputEnd = input + inputSize;
+    std::size_t index = 0;
+    // each group loads 16 bytes, so stop while a full load is still in bounds
+    while(count - index >= 4 && inputEnd - data >= 16)
+    {
+        unsigned control = controlBytes[index / 4];
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+        __m128i shuffle =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(tables.shuffles[control]));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(values + index),
+                         _mm_shuffle_epi8(bytes, shuffle));
+        data += tables.dataSizes[control];
+        index += 4;
+    }
+    data += decodeScalarTail(controlBytes, data, values, index, count);
+    return data - input;
+}
+
+bool hasSSSE3() noexcept
+{
+    static const bool retval = __builtin_cpu_supports("ssse3");
+    return retval;
+}
+#endif
+
+#ifdef VARINT_USE_NEON
+std::size_t decodeNEON(const unsigned char *input,
+                       std::size_t inputSize,
+                       std::uint32_t *values,
+                       std::size_t count) noexcept
+{
+    const StreamVByteTables &tables = StreamVByteTables::get();
+    const unsigned char *controlBytes = input;
+    const unsigned char *data = input + getStreamVByteControlSize(count);
+    const unsigned char *inputEnd = input + inputSize;
+    std::size_t index = 0;
+    while(count - index >= 4 && inputEnd - data >= 16)
+    {
+        unsigned control = controlBytes[index / 4];
+        uint8x16_t bytes = vld1q_u8(data);
+        uint8x16_t shuffle = vld1q_u8(tables.shuffles[control]);
+        vst1q_u32(values + index, vreinterpretq_u32_u8(vqtbl1q_u8(bytes, shuffle)));
+        data += tables.dataSizes[control];
+        index += 4;
+    }
+    data += decodeScalarTail(controlBytes, data, values, index, count);
+    return data - input;
+}
+#endif
+}
+
+std::size_t getStreamVByteDataSize(const unsigned char *controlBytes, std::size_t count) noexcept
+{
+    const StreamVByteTables &tables = StreamVByteTables::get();
+    std::size_t retval = 0;
+    std::size_t fullControlBytes = count / 4;
+    for(std::size_t i = 0; i < fullControlBytes; i++)
+        retval += tables.dataSizes[controlBytes[i]];
+    for(std::size_t i = fullControlBytes * 4; i < count; i++)
+        retval += ((controlBytes[i / 4] >> (2 * (i % 4))) & 3) + 1;
+    return retval;
+}
+
+std::size_t streamVByteEncode(const std::uint32_t *values,
+                              std::size_t count,
+                              unsigned char *output) noexcept
+{
+    if(count == 0)
+        return 0;
+    unsigned char *controlBytes = output;
+    unsigned char *data = output + getStreamVByteControlSize(count);
+    std::memset(controlBytes, 0, getStreamVByteControlSize(count));
+    for(std::size_t i = 0; i < count; i++)
+    {
+        std::uint32_t value = values[i];
+        std::size_t code = getStreamVByteCode(value);
+        controlBytes[i / 4] |= static_cast<unsigned char>(code << (2 * (i % 4)));
+        for(std::size_t j = 0; j <= code; j++)
+        {
+            *data++ = static_cast<unsigned char>(value >> (8 * j));
+        }
+    }
+    return data - output;
+}
+
+std::size_t streamVByteDecodeScalar(const unsigned char *input,
+                                    std::size_t inputSize,
+                                    std::uint32_t *values,
+                                    std::size_t count) noexcept
+{
+    std::size_t controlSize = getStreamVByteControlSize(count);
+    constexprAssert(inputSize >= controlSize);
+    std::size_t dataSize = decodeScalarTail(input, input + controlSize, values, 0, count);
+    constexprAssert(inputSize >= controlSize + dataSize);
+    return controlSize + dataSize;
+}
+
+std::size_t streamVByteDecode(const unsigned char *input,
+                              std::size_t inputSize,
+                              std::uint32_t *values,
+                              std::size_t count) noexcept
+{
+#if defined(VARINT_USE_SSSE3)
+    if(hasSSSE3())
+        return decodeSSSE3(input, inputSize, values, count);
+#elif defined(VARINT_USE_NEON)
+    return decodeNEON(input, inputSize, values, count);
+#endif
+    return streamVByteDecodeScalar(input, inputSize, values, count);
+}
+}
+}
+}
+}
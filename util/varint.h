@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2012-2016 Jacob R. Lifshay
+ * This file is part of Voxels.
+ *
+ * Voxels is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Voxels is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Voxels; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#ifndef UTIL_VARINT_H_
+#define UTIL_VARINT_H_
+
+#include <cstdint>
+#include <cstddef>
+#include "constexpr_assert.h"
+
+namespace programmerjake
+{
+namespace voxels
+{
+namespace util
+{
+namespace varint
+{
+constexpr std::size_t maxVarUInt32Size = 5;
+constexpr std::size_t maxVarUInt64Size = 10;
+
+constexpr std::uint32_t zigZagEncode32(std::int32_t value) noexcept
+{
+    return (static_cast<std::uint32_t>(value) << 1) ^ static_cast<std::uint32_t>(value >> 31);
+}
+
+constexpr std::int32_t zigZagDecode32(std::uint32_t value) noexcept
+{
+    return static_cast<std::int32_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+constexpr std::uint64_t zigZagEncode64(std::int64_t value) noexcept
+{
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+constexpr std::int64_t zigZagDecode64(std::uint64_t value) noexcept
+{
+    return static_cast<std::int64_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+/** encodes value as LEB128 into buffer, which must hold at least maxVarUInt64Size bytes
+ * @return the number of bytes written
+ */
+inline std::size_t encodeVarUInt(std::uint64_t value, unsigned char *buffer) noexcept
+{
+    std::size_t retval = 0;
+    while(value >= 0x80)
+    {
+        buffer[retval++] = static_cast<unsigned char>(value | 0x80);
+        value >>= 7;
+    }
+    buffer[retval++] = static_cast<unsigned char>(value);
+    return retval;
+}
+
+/** the number of bytes encodeVarUInt writes for value */
+inline std::size_t getVarUIntSize(std::uint64_t value) noexcept
+{
+    std::size_t retval = 1;
+    while(value >= 0x80)
+    {
+        value >>= 7;
+        retval++;
+    }
+    return retval;
+}
+
+/** Stream VByte: an array of 32-bit integers is stored as (count + 3) / 4 control bytes followed
+ * by the data bytes. Each control byte holds four 2-bit codes (first value in the low bits), each
+ * code being one less than the number of little-endian bytes used for the corresponding value.
+ *
+ * The SIMD and scalar decoders produce identical results; the encoder is scalar only.
+ */
+constexpr std::size_t getStreamVByteControlSize(std::size_t count) noexcept
+{
+    return (count + 3) / 4;
+}
+
+constexpr std::size_t getStreamVByteMaxEncodedSize(std::size_t count) noexcept
+{
+    return getStreamVByteControlSize(count) + count * sizeof(std::uint32_t);
+}
+
+/** the stream readVarU32Array/writeVarU32Array functions split arrays into independently
+ * encoded blocks of at most this many values
+ */
+constexpr std::size_t streamVByteBlockSize = 256;
+
+/** @return the number of data bytes following controlBytes */
+std::size_t getStreamVByteDataSize(const unsigned char *controlBytes, std::size_t count) noexcept;
+
+/** encodes count values into output, which must hold at least
+ * getStreamVByteMaxEncodedSize(count) bytes
+ * @return the number of bytes written
+ */
+std::size_t streamVByteEncode(const std::uint32_t *values,
+                              std::size_t count,
+                              unsigned char *output) noexcept;
+
+/** decodes count values from input, which must hold a complete encoding of count values
+ * @return the number of bytes read
+ */
+std::size_t streamVByteDecode(const unsigned char *input,
+                              std::size_t inputSize,
+                              std::uint32_t *values,
+                              std::size_t count) noexcept;
+
+/** the portable decoder that streamVByteDecode falls back to */
+std::size_t streamVByteDecodeScalar(const unsigned char *input,
+                                    std::size_t inputSize,
+                                    std::uint32_t *values,
+                                    std::size_t count) noexcept;
+}
+}
+}
+}
+
+#endif /* UTIL_VARINT_H_ */